@@ -61,6 +61,13 @@ void SDIOAnalyzer::WorkerThread()
 
     anlyStep = FIND_CMD_START;
     frameState = START_BIT;
+    startOfNextFrame = 0;
+    frameCounter = 0;
+    respLength = 0;
+    respType = 0;
+    temp = 0;
+    temp2 = 0;
+    lastHostCmd = -1; //还没有主机命令
     clkCurrentSmpNum = 0; //当前CLK采样点
     dataNum = 0; //数据读取计数
 
@@ -128,14 +135,6 @@ void SDIOAnalyzer::WorkerThread()
 
 bool SDIOAnalyzer::FrameStateMachine()
 {
-    static U64 startOfNextFrame = 0;
-    static U32 frameCounter = 0;
-    static U8 respLength;
-    static U8 respType;
-    static U64 temp;
-    static U64 temp2;
-    static char lastHostCmd = -1;
-
     // 上升沿采样
     if (mSettings->mSampleRead == RISING_EDGE) {
         if (mClock->GetBitState() == BIT_HIGH) {
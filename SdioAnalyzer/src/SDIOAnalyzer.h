@@ -47,6 +47,14 @@ private:
     bool FrameStateMachine();
     enum frameStates {START_BIT, TRANSMISSION_BIT, COMMAND, ARGUMENT, CRC7, STOP};
     U32 frameState;
+    //FrameStateMachine 的状态，每个实例各自一份，在 WorkerThread 中复位
+    U64 startOfNextFrame;
+    U32 frameCounter;
+    U8 respLength;
+    U8 respType;
+    U64 temp;
+    U64 temp2;      //R2 响应的高64位
+    char lastHostCmd;   //上一条主机命令，ACMD 置 0x80
 
     bool getDataLinesStartBit();
     bool readDataLines();
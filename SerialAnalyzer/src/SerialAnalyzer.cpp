@@ -1,6 +1,16 @@
 #include "SerialAnalyzer.h"
 #include "SerialAnalyzerSettings.h"
 #include <AnalyzerChannelData.h>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+    bool FrameStartsBefore(const Frame &a, const Frame &b)
+    {
+        return a.mStartingSampleInclusive < b.mStartingSampleInclusive;
+    }
+}
 
 SerialAnalyzer::SerialAnalyzer()
     : Analyzer(),
@@ -45,6 +55,98 @@ void SerialAnalyzer::ComputeSampleOffsets()
 
     //and 1/2 bit before end of the stop bit period
     mEndOfStopBitOffset = clock_generator.AdvanceByHalfPeriod(mSettings->mStopBits - 1.0);  //if stopbits == 1.0, this will be 0
+
+    //line statistics: the nominal length of one character, start bit through stop bits.
+    mCharacterHalfBits = 2 * (1 + mSampleOffsets.size()) + U64(2.0 * mSettings->mStopBits);
+    if (mSettings->mParity != AnalyzerEnums::None) {
+        mCharacterHalfBits += 2;
+    }
+    double samples_per_bit = double(mSampleRateHz) / double(mSettings->mBitRate);
+    mCharacterSamples = U64(samples_per_bit * double(mCharacterHalfBits) / 2.0);
+    mBackToBackSamples = U64(samples_per_bit * (double(mCharacterHalfBits) / 2.0 + 1.0));
+
+    mStatisticsWindowSamples = U64(mSampleRateHz) * mSettings->mStatisticsWindowMs / 1000;
+    if (mStatisticsWindowSamples == 0) {
+        mStatisticsWindowSamples = 1;
+    }
+}
+
+void SerialAnalyzer::UpdateLineStatistics(U64 frame_starting_sample, bool parity_error, bool framing_error)
+{
+    U64 window_starting_sample = frame_starting_sample - (frame_starting_sample % mStatisticsWindowSamples);
+
+    if ((mLineStatistics.mCharacters == 0) || (mLineStatistics.mWindowStartingSample != window_starting_sample)) {
+        memset(&mLineStatistics, 0, sizeof(mLineStatistics));
+        mLineStatistics.mWindowStartingSample = window_starting_sample;
+    }
+
+    mLineStatistics.mCharacters++;
+    mLineStatistics.mBusySamples += mCharacterSamples;
+    if (parity_error == true) {
+        mLineStatistics.mParityErrors++;
+    }
+    if (framing_error == true) {
+        mLineStatistics.mFramingErrors++;
+    }
+
+    //the baud rate is only measurable between characters sent back-to-back (less than one bit of idle between them).
+    if (mPreviousStartSample != 0) {
+        U64 spacing = frame_starting_sample - mPreviousStartSample;
+        if (spacing < mBackToBackSamples) {
+            mLineStatistics.mBaudSamples += spacing;
+            mLineStatistics.mBaudHalfBits += mCharacterHalfBits;
+        }
+    }
+    mPreviousStartSample = frame_starting_sample;
+
+    mResults->UpdateLineStatistics(mLineStatistics);
+}
+
+void SerialAnalyzer::AddTextCharacter(U64 frame_starting_sample, U8 character)
+{
+    const U32 max_line_length = 4096;   //keeps binary data from turning into one endless line
+
+    bool is_lf_after_cr = (character == '\n') && (mPreviousCharacterWasCr == true);
+    mPreviousCharacterWasCr = (character == '\r');
+    if (is_lf_after_cr == true) {
+        return;     //the second half of a CR/LF pair belongs to the line that was just ended.
+    }
+
+    //the next packet is only started once the next line begins, so the terminators stay in the packet of the line they end.
+    if (mTextLineEnded == true) {
+        mResults->CommitPacketAndStartNewPacket();
+        mTextLineEnded = false;
+    }
+
+    if ((character == '\r') || (character == '\n')) {
+        mResults->EndTextLine(frame_starting_sample);
+        mTextLineEnded = true;
+        return;
+    }
+
+    if (mResults->AddTextLineCharacter(frame_starting_sample, character) >= max_line_length) {
+        mResults->EndTextLine(frame_starting_sample);
+        mTextLineEnded = true;
+    }
+}
+
+bool SerialAnalyzer::IsParityError(U64 data, BitState parity_bit) const
+{
+    bool is_even = AnalyzerHelpers::IsEven(AnalyzerHelpers::GetOnesCount(data));
+
+    if (mSettings->mParity == AnalyzerEnums::Even) {
+        if (is_even == true) {
+            return parity_bit != mBitLow;   //we expect a low bit, to keep the parity even.
+        } else {
+            return parity_bit != mBitHigh;  //we expect a high bit, to force parity even.
+        }
+    } else { //if( mSettings->mParity == AnalyzerEnums::Odd )
+        if (is_even == false) {
+            return parity_bit != mBitLow;   //we expect a low bit, to keep the parity odd.
+        } else {
+            return parity_bit != mBitHigh;  //we expect a high bit, to force parity odd.
+        }
+    }
 }
 
 void SerialAnalyzer::SetupResults()
@@ -62,6 +164,12 @@ void SerialAnalyzer::WorkerThread()
 {
     mSampleRateHz = GetSampleRate();    // 获取采样频率
     ComputeSampleOffsets();
+    memset(&mLineStatistics, 0, sizeof(mLineStatistics));
+    mPreviousStartSample = 0;
+    mAddressSelected = true;    //until the first address is seen, we don't know who the data is for.
+    mTextLineEnded = false;
+    mPreviousCharacterWasCr = false;
+    mXmodemDecoder.Reset(mResults.get(), mSettings.get(), mSampleRateHz);
     U32 num_bits = mSettings->mBitsPerTransfer;
 
     if (mSettings->mSerialMode != SerialAnalyzerEnums::Normal) {
@@ -83,6 +191,11 @@ void SerialAnalyzer::WorkerThread()
         mask <<= 1;
     }
 
+    if (mSettings->IsMultiLane() == true) {
+        WorkerThreadMultiLane(num_bits, bit_mask);
+        return;
+    }
+
     // 要访问采样数据，还需每个通道数据 AnalyzerChannelData 的指针，异步串行协议只需一个。
     mSerial = GetAnalyzerChannelData(mSettings->mInputChannel);
     mSerial->TrackMinimumPulseWidth();
@@ -105,14 +218,10 @@ void SerialAnalyzer::WorkerThread()
 
         DataBuilder data_builder;
         data_builder.Reset(&data, mSettings->mShiftOrder, num_bits);
-        U64 marker_location = frame_starting_sample;
 
         for (U32 i = 0; i < num_bits; i++) {
             mSerial->Advance(mSampleOffsets[i]);
             data_builder.AddBit(mSerial->GetBitState());
-
-            marker_location += mSampleOffsets[i];
-            mResults->AddMarker(marker_location, AnalyzerResults::Dot, mSettings->mInputChannel);
         }
         if (mSettings->mInverted == true) {
             data = (~data) & bit_mask;
@@ -138,44 +247,37 @@ void SerialAnalyzer::WorkerThread()
             }
             //now remove the msb.
             data &= (bit_mask >> 1);
+
+            if (mp_is_address == true) {
+                mAddressSelected = mSettings->IsAddressSelected(data);
+            }
+        }
+
+        //with an address filter, data sent to other nodes is still clocked in (to keep track of framing), but not recorded.
+        bool record_character = (mp_is_address == true) || (mAddressSelected == true);
+
+        if (record_character == true) {
+            U64 marker_location = frame_starting_sample;
+            for (U32 i = 0; i < num_bits; i++) {
+                marker_location += mSampleOffsets[i];
+                mResults->AddMarker(marker_location, AnalyzerResults::Dot, mSettings->mInputChannel);
+            }
         }
 
         parity_error = false;
 
         if (mSettings->mParity != AnalyzerEnums::None) {
             mSerial->Advance(mParityBitOffset);
-            bool is_even = AnalyzerHelpers::IsEven(AnalyzerHelpers::GetOnesCount(data));
-
-            if (mSettings->mParity == AnalyzerEnums::Even) {
-                if (is_even == true) {
-                    if (mSerial->GetBitState() != mBitLow) { //we expect a low bit, to keep the parity even.
-                        parity_error = true;
-                    }
-                } else {
-                    if (mSerial->GetBitState() != mBitHigh) { //we expect a high bit, to force parity even.
-                        parity_error = true;
-                    }
-                }
-            } else { //if( mSettings->mParity == AnalyzerEnums::Odd )
-                if (is_even == false) {
-                    if (mSerial->GetBitState() != mBitLow) { //we expect a low bit, to keep the parity odd.
-                        parity_error = true;
-                    }
-                } else {
-                    if (mSerial->GetBitState() != mBitHigh) { //we expect a high bit, to force parity odd.
-                        parity_error = true;
-                    }
-                }
-            }
+            parity_error = IsParityError(data, mSerial->GetBitState());
 
-            marker_location += mParityBitOffset;
-            mResults->AddMarker(marker_location, AnalyzerResults::Square, mSettings->mInputChannel);
+            mResults->AddMarker(mSerial->GetSampleNumber(), AnalyzerResults::Square, mSettings->mInputChannel);
         }
 
         //now we must dermine if there is a framing error.
         framing_error = false;
 
         mSerial->Advance(mStartOfStopBitOffset);
+        U64 stop_bit_sample = mSerial->GetSampleNumber();
 
         if (mSerial->GetBitState() != mBitHigh) {
             framing_error = true;
@@ -186,8 +288,8 @@ void SerialAnalyzer::WorkerThread()
             }
         }
 
-        if (framing_error == true) {
-            marker_location += mStartOfStopBitOffset;
+        if ((framing_error == true) && (record_character == true)) {
+            U64 marker_location = stop_bit_sample;
             mResults->AddMarker(marker_location, AnalyzerResults::ErrorX, mSettings->mInputChannel);
 
             if (mEndOfStopBitOffset != 0) {
@@ -196,12 +298,13 @@ void SerialAnalyzer::WorkerThread()
             }
         }
 
-        //ok now record the value!
-        //note that we're not using the mData2 or mType fields for anything, so we won't bother to set them.
+        //ok now record the value! mData2 is the lane, which is always the Data channel here.
         Frame frame;
         frame.mStartingSampleInclusive = frame_starting_sample;
         frame.mEndingSampleInclusive = mSerial->GetSampleNumber();
         frame.mData1 = data;
+        frame.mData2 = 0;
+        frame.mType = SerialCharacterFrame;
         frame.mFlags = 0;
         if (parity_error == true) {
             frame.mFlags |= PARITY_ERROR_FLAG | DISPLAY_AS_ERROR_FLAG;
@@ -219,9 +322,27 @@ void SerialAnalyzer::WorkerThread()
             mResults->CommitPacketAndStartNewPacket();
         }
 
-        mResults->AddFrame(frame);
+        if (mSettings->mTextMode == true) {
+            AddTextCharacter(frame_starting_sample, U8(data));
+        }
 
-        mResults->CommitResults();
+        if (mSettings->mXmodemMode == true) {
+            SerialCharacter character;
+            character.mStartingSampleInclusive = frame.mStartingSampleInclusive;
+            character.mEndingSampleInclusive = frame.mEndingSampleInclusive;
+            character.mValue = U8(data);
+            character.mFlags = frame.mFlags;
+            mXmodemDecoder.AddCharacter(character);     //adds the frames itself, block by block
+            if (mSerial->DoMoreTransitionsExistInCurrentData() == false) {
+                mXmodemDecoder.EndOfData();     //the capture may end in the middle of a block
+            }
+            mResults->CommitResults();
+        } else if (record_character == true) {
+            mResults->AddFrame(frame);
+            mResults->CommitResults();
+        }
+
+        UpdateLineStatistics(frame_starting_sample, parity_error, framing_error);
 
         ReportProgress(frame.mEndingSampleInclusive);
         CheckIfThreadShouldExit();
@@ -234,6 +355,149 @@ void SerialAnalyzer::WorkerThread()
     }
 }
 
+//All lanes share the bit offsets computed for the Data channel, and are swept together one window at a time:
+//every character starting inside the window is decoded, lane by lane, and the window's characters are then handed
+//to the results in start order. Frames can't overlap, even on different channels, and characters of different lanes
+//often do, so only the Data channel's characters become frames; the other lanes get start and stop markers, and
+//every lane's characters are kept with their real times for the exports.
+void SerialAnalyzer::WorkerThreadMultiLane(U32 num_bits, U64 bit_mask)
+{
+    mLanes.clear();
+    for (U32 i = 0; i < SERIAL_MAX_LANES; i++) {
+        Channel channel = mSettings->GetLaneChannel(i);
+        if (channel == UNDEFINED_CHANNEL) {
+            continue;
+        }
+
+        SerialLane lane;
+        lane.mIndex = i;
+        lane.mChannel = channel;
+        lane.mData = GetAnalyzerChannelData(channel);
+        mLanes.push_back(lane);
+    }
+
+    mSerial = mLanes[0].mData;  //autobaud follows the Data channel
+    mSerial->TrackMinimumPulseWidth();
+
+    U32 num_lanes = U32(mLanes.size());
+    for (U32 i = 0; i < num_lanes; i++) {
+        if (mLanes[i].mData->GetBitState() == mBitLow) {
+            mLanes[i].mData->AdvanceToNextEdge();
+        }
+    }
+
+    const U64 window_samples = mCharacterSamples * 64;
+    U64 window_end = 0;
+
+    for (; ;) {
+        window_end += window_samples;
+
+        mLaneFrames.clear();
+        for (U32 i = 0; i < num_lanes; i++) {
+            SerialLane &lane = mLanes[i];
+
+            //the line is idle here, so the next edge is a start bit.
+            while (lane.mData->WouldAdvancingToAbsPositionCauseTransition(window_end) == true) {
+                lane.mData->AdvanceToNextEdge();
+
+                Frame frame;
+                DecodeLaneCharacter(lane, num_bits, bit_mask, frame);
+                mLaneFrames.push_back(frame);
+            }
+        }
+
+        std::stable_sort(mLaneFrames.begin(), mLaneFrames.end(), FrameStartsBefore);
+
+        mResults->AddLaneCharacters(mLaneFrames);
+
+        U32 num_frames = U32(mLaneFrames.size());
+        for (U32 i = 0; i < num_frames; i++) {
+            const Frame &frame = mLaneFrames[i];
+            if (frame.mData2 == 0) {
+                mResults->AddFrame(frame);
+                UpdateLineStatistics(frame.mStartingSampleInclusive, (frame.mFlags & PARITY_ERROR_FLAG) != 0, (frame.mFlags & FRAMING_ERROR_FLAG) != 0);
+            }
+        }
+        mResults->CommitResults();
+
+        ReportProgress(window_end);
+        CheckIfThreadShouldExit();
+    }
+}
+
+void SerialAnalyzer::DecodeLaneCharacter(SerialLane &lane, U32 num_bits, U64 bit_mask, Frame &frame)
+{
+    AnalyzerChannelData *serial = lane.mData;
+    U64 frame_starting_sample = serial->GetSampleNumber();
+
+    U64 data = 0;
+    DataBuilder data_builder;
+    data_builder.Reset(&data, mSettings->mShiftOrder, num_bits);
+
+    if (lane.mIndex != 0) {     //no frame of its own, so mark where the character starts and ends
+        mResults->AddMarker(frame_starting_sample, AnalyzerResults::Start, lane.mChannel);
+    }
+
+    U64 marker_location = frame_starting_sample;
+    for (U32 i = 0; i < num_bits; i++) {
+        serial->Advance(mSampleOffsets[i]);
+        data_builder.AddBit(serial->GetBitState());
+
+        marker_location += mSampleOffsets[i];
+        mResults->AddMarker(marker_location, AnalyzerResults::Dot, lane.mChannel);
+    }
+    if (mSettings->mInverted == true) {
+        data = (~data) & bit_mask;
+    }
+
+    bool parity_error = false;
+    if (mSettings->mParity != AnalyzerEnums::None) {
+        serial->Advance(mParityBitOffset);
+        parity_error = IsParityError(data, serial->GetBitState());
+        mResults->AddMarker(serial->GetSampleNumber(), AnalyzerResults::Square, lane.mChannel);
+    }
+
+    bool framing_error = false;
+    serial->Advance(mStartOfStopBitOffset);
+    U64 stop_bit_sample = serial->GetSampleNumber();
+
+    if (serial->GetBitState() != mBitHigh) {
+        framing_error = true;
+    } else if (serial->Advance(mEndOfStopBitOffset) != 0) {
+        framing_error = true;
+    }
+
+    if (framing_error == true) {
+        mResults->AddMarker(stop_bit_sample, AnalyzerResults::ErrorX, lane.mChannel);
+        if (mEndOfStopBitOffset != 0) {
+            mResults->AddMarker(stop_bit_sample + mEndOfStopBitOffset, AnalyzerResults::ErrorX, lane.mChannel);
+        }
+    }
+
+    if (lane.mIndex != 0) {
+        mResults->AddMarker(serial->GetSampleNumber(), AnalyzerResults::Stop, lane.mChannel);
+    }
+
+    frame.mStartingSampleInclusive = frame_starting_sample;
+    frame.mEndingSampleInclusive = serial->GetSampleNumber();
+    frame.mData1 = data;
+    frame.mData2 = lane.mIndex;
+    frame.mType = SerialCharacterFrame;
+    frame.mFlags = 0;
+    if (parity_error == true) {
+        frame.mFlags |= PARITY_ERROR_FLAG | DISPLAY_AS_ERROR_FLAG;
+    }
+    if (framing_error == true) {
+        frame.mFlags |= FRAMING_ERROR_FLAG | DISPLAY_AS_ERROR_FLAG;
+    }
+
+    if (framing_error == true) { //if we're still low, let's fix that for the next round.
+        if (serial->GetBitState() == mBitLow) {
+            serial->AdvanceToNextEdge();
+        }
+    }
+}
+
 bool SerialAnalyzer::NeedsRerun()
 {
     if (mSettings->mUseAutobaud == false) {
@@ -4,9 +4,17 @@
 #include <Analyzer.h>
 #include "SerialAnalyzerResults.h"
 #include "SerialSimulationDataGenerator.h"
+#include "SerialXmodemDecoder.h"
 
 class SerialAnalyzerSettings;
 
+//one of the lines decoded together in multi-lane mode
+struct SerialLane {
+    U32 mIndex;                 //0 for the Data channel, n for "Data n+1"; stored in the frames' mData2
+    Channel mChannel;
+    AnalyzerChannelData *mData;
+};
+
 class ANALYZER_EXPORT SerialAnalyzer : public Analyzer
 {
 public:
@@ -27,6 +35,11 @@ public:
 
 protected: //functions
     void ComputeSampleOffsets();
+    void UpdateLineStatistics(U64 frame_starting_sample, bool parity_error, bool framing_error);
+    void AddTextCharacter(U64 frame_starting_sample, U8 character);
+    bool IsParityError(U64 data, BitState parity_bit) const;
+    void WorkerThreadMultiLane(U32 num_bits, U64 bit_mask);
+    void DecodeLaneCharacter(SerialLane &lane, U32 num_bits, U64 bit_mask, Frame &frame);
 
 protected: //vars
     std::auto_ptr< SerialAnalyzerSettings > mSettings;
@@ -44,6 +57,25 @@ protected: //vars
     U32 mEndOfStopBitOffset;
     BitState mBitLow;
     BitState mBitHigh;
+    bool mAddressSelected;      //MP mode: the last address passed the address filter
+
+    //line statistics vars:
+    U64 mStatisticsWindowSamples;
+    U64 mCharacterHalfBits;
+    U64 mCharacterSamples;
+    U64 mBackToBackSamples;
+    U64 mPreviousStartSample;
+    SerialLineStatistics mLineStatistics;
+
+    //text mode vars:
+    bool mTextLineEnded;
+    bool mPreviousCharacterWasCr;
+
+    SerialXmodemDecoder mXmodemDecoder;
+
+    //multi-lane vars:
+    std::vector<SerialLane> mLanes;
+    std::vector<Frame> mLaneFrames;     //characters of the current window, from every lane
 
 #pragma warning( pop )
 };
@@ -5,11 +5,71 @@
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
+#include <map>
+
+namespace
+{
+    //collects payload bytes and hands them to AppendToFile in large blocks.
+    class BinaryExportFile
+    {
+    public:
+        explicit BinaryExportFile(const std::string &file_name)
+            : mFile(AnalyzerHelpers::StartFile(file_name.c_str(), true))
+        {
+            mBuffer.reserve(BUFFER_SIZE);
+        }
+
+        ~BinaryExportFile()
+        {
+            Flush();
+            AnalyzerHelpers::EndFile(mFile);
+        }
+
+        void Append(U64 value, U32 num_bytes)
+        {
+            for (U32 i = 0; i < num_bytes; i++) {   //least significant byte first, the same order the bits are sent in.
+                mBuffer.push_back(U8(value >> (8 * i)));
+            }
+
+            if (mBuffer.size() >= BUFFER_SIZE) {
+                Flush();
+            }
+        }
+
+    protected:
+        enum { BUFFER_SIZE = 1024 * 1024 };
+
+        void Flush()
+        {
+            if (mBuffer.empty() == false) {
+                AnalyzerHelpers::AppendToFile(&mBuffer[0], U32(mBuffer.size()), mFile);
+                mBuffer.clear();
+            }
+        }
+
+        void *mFile;
+        std::vector<U8> mBuffer;
+    };
+
+    //"capture.bin" + "addr_0x12" -> "capture_addr_0x12.bin"
+    std::string SplitFileName(const char *file, const std::string &tag)
+    {
+        std::string name(file);
+        std::string::size_type dot = name.find_last_of('.');
+        std::string::size_type slash = name.find_last_of("/\\");
+
+        if ((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash))) {
+            return name + "_" + tag;
+        }
+        return name.substr(0, dot) + "_" + tag + name.substr(dot);
+    }
+}
 
 SerialAnalyzerResults::SerialAnalyzerResults(SerialAnalyzer *analyzer, SerialAnalyzerSettings *settings)
     :   AnalyzerResults(),
         mSettings(settings),
-        mAnalyzer(analyzer)
+        mAnalyzer(analyzer),
+        mTextLineOpen(false)
 {
 }
 
@@ -17,12 +77,28 @@ SerialAnalyzerResults::~SerialAnalyzerResults()
 {
 }
 
-void SerialAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel & /*channel*/, DisplayBase display_base)   //unrefereced vars commented out to remove warnings.
+void SerialAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel &channel, DisplayBase display_base)
 {
     //we only need to pay attention to 'channel' if we're making bubbles for more than one channel (as set by AddChannelBubblesWillAppearOn)
     ClearResultStrings();
     Frame frame = GetFrame(frame_index);
 
+    if ((mSettings->IsMultiLane() == true) && (mSettings->GetLaneChannel(U32(frame.mData2)) != channel)) {
+        return;     //another lane's character
+    }
+
+    char xmodem_str[128];
+    if (GetXmodemFrameText(frame, xmodem_str, sizeof(xmodem_str)) == true) {
+        if (frame.mType == XmodemBlockFrame) {
+            char block_str[32];
+            snprintf(block_str, sizeof(block_str), "Blk %u", U32(frame.mData1));
+            AddResultString("B");
+            AddResultString(block_str);
+        }
+        AddResultString(xmodem_str);
+        return;
+    }
+
     bool framing_error = false;
     if ((frame.mFlags & FRAMING_ERROR_FLAG) != 0) {
         framing_error = true;
@@ -90,9 +166,23 @@ void SerialAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel & /*chan
     }
 }
 
-void SerialAnalyzerResults::GenerateExportFile(const char *file, DisplayBase display_base, U32 /*export_type_user_id*/)
+void SerialAnalyzerResults::GenerateExportFile(const char *file, DisplayBase display_base, U32 export_type_user_id)
 {
-    //export_type_user_id is only important if we have more than one export type.
+    if (export_type_user_id == 1) {
+        GenerateStatisticsExportFile(file);
+        return;
+    }
+
+    if (export_type_user_id == 2) {
+        GenerateBinaryExportFile(file);
+        return;
+    }
+
+    if (mSettings->mTextMode == true) {
+        GenerateTextLineExportFile(file);   //one row per line rather than per character
+        return;
+    }
+
     std::stringstream ss;
 
     U64 trigger_sample = mAnalyzer->GetTriggerSample();
@@ -101,21 +191,42 @@ void SerialAnalyzerResults::GenerateExportFile(const char *file, DisplayBase dis
 
     void *f = AnalyzerHelpers::StartFile(file);
 
+    bool multi_lane = mSettings->IsMultiLane();
+    std::vector<Frame> lane_characters;     //multi-lane: the characters of every lane, not just the Data channel's frames
+    if (multi_lane == true) {
+        std::lock_guard<std::mutex> lock(mLaneCharactersMutex);
+        lane_characters = mLaneCharacters;
+        num_frames = lane_characters.size();
+    }
+
     if (mSettings->mSerialMode == SerialAnalyzerEnums::Normal) {
         //Normal case -- not MP mode.
-        ss << "Time [s],Value,Parity Error,Framing Error" << std::endl;
+        if (multi_lane == true) {
+            ss << "Time [s],Lane,Value,Parity Error,Framing Error" << std::endl;
+        } else {
+            ss << "Time [s],Value,Parity Error,Framing Error" << std::endl;
+        }
 
         for (U32 i = 0; i < num_frames; i++) {
-            Frame frame = GetFrame(i);
+            Frame frame = (multi_lane == true) ? lane_characters[i] : GetFrame(i);
 
             //static void GetTimeString( U64 sample, U64 trigger_sample, U32 sample_rate_hz, char* result_string, U32 result_string_max_length );
             char time_str[128];
             AnalyzerHelpers::GetTimeString(frame.mStartingSampleInclusive, trigger_sample, sample_rate, time_str, 128);
 
-            char number_str[128];
-            AnalyzerHelpers::GetNumberString(frame.mData1, display_base, mSettings->mBitsPerTransfer, number_str, 128);
+            if (multi_lane == true) {
+                ss << time_str << "," << (frame.mData2 + 1) << ",";
+            } else {
+                ss << time_str << ",";
+            }
 
-            ss << time_str << "," << number_str;
+            char number_str[128];
+            if (GetXmodemFrameText(frame, number_str, 128) == true) {
+                ss << "\"" << number_str << "\"";    //block descriptions contain commas
+            } else {
+                AnalyzerHelpers::GetNumberString(frame.mData1, display_base, mSettings->mBitsPerTransfer, number_str, 128);
+                ss << number_str;
+            }
 
             if ((frame.mFlags & PARITY_ERROR_FLAG) != 0) {
                 ss << ",Error,";
@@ -187,11 +298,341 @@ void SerialAnalyzerResults::GenerateExportFile(const char *file, DisplayBase dis
     AnalyzerHelpers::EndFile(f);
 }
 
+void SerialAnalyzerResults::UpdateLineStatistics(const SerialLineStatistics &window)
+{
+    std::lock_guard<std::mutex> lock(mLineStatisticsMutex);
+
+    //the window still being decoded is updated in place, so the export always includes it.
+    if ((mLineStatistics.empty() == false) && (mLineStatistics.back().mWindowStartingSample == window.mWindowStartingSample)) {
+        mLineStatistics.back() = window;
+    } else {
+        mLineStatistics.push_back(window);
+    }
+}
+
+void SerialAnalyzerResults::GenerateStatisticsExportFile(const char *file)
+{
+    std::vector<SerialLineStatistics> windows;
+    {
+        std::lock_guard<std::mutex> lock(mLineStatisticsMutex);
+        windows = mLineStatistics;
+    }
+
+    U64 trigger_sample = mAnalyzer->GetTriggerSample();
+    U32 sample_rate = mAnalyzer->GetSampleRate();
+    U64 window_samples = U64(sample_rate) * mSettings->mStatisticsWindowMs / 1000;
+    if (window_samples == 0) {
+        window_samples = 1;
+    }
+
+    void *f = AnalyzerHelpers::StartFile(file);
+
+    std::stringstream ss;
+    ss << "Time [s],Characters,Parity Errors,Framing Errors,Utilization [%],Measured Baud" << std::endl;
+
+    U64 num_windows = windows.size();
+    for (U64 i = 0; i < num_windows; i++) {
+        const SerialLineStatistics &window = windows[i];
+
+        char time_str[128];
+        AnalyzerHelpers::GetTimeString(window.mWindowStartingSample, trigger_sample, sample_rate, time_str, 128);
+
+        double utilization = 100.0 * double(window.mBusySamples) / double(window_samples);
+        if (utilization > 100.0) {
+            utilization = 100.0;
+        }
+
+        ss << time_str << "," << window.mCharacters << "," << window.mParityErrors << "," << window.mFramingErrors << "," << utilization << ",";
+
+        if (window.mBaudSamples != 0) {
+            ss << U32(double(sample_rate) * double(window.mBaudHalfBits) / (2.0 * double(window.mBaudSamples)) + 0.5);
+        }
+
+        ss << std::endl;
+
+        //the rows are short, so write them out in large blocks.
+        if (ss.tellp() >= 64 * 1024) {
+            AnalyzerHelpers::AppendToFile((U8 *)ss.str().c_str(), ss.str().length(), f);
+            ss.str(std::string());
+
+            if (UpdateExportProgressAndCheckForCancel(i, num_windows) == true) {
+                AnalyzerHelpers::EndFile(f);
+                return;
+            }
+        }
+    }
+
+    AnalyzerHelpers::AppendToFile((U8 *)ss.str().c_str(), ss.str().length(), f);
+
+    UpdateExportProgressAndCheckForCancel(num_windows, num_windows);
+    AnalyzerHelpers::EndFile(f);
+}
+
+void SerialAnalyzerResults::GenerateBinaryExportFile(const char *file)
+{
+    U32 bits_per_transfer = mSettings->mBitsPerTransfer;
+    if (mSettings->mSerialMode != SerialAnalyzerEnums::Normal) {
+        bits_per_transfer--;
+    }
+    U32 bytes_per_transfer = (bits_per_transfer + 7) / 8;
+
+    SerialAnalyzerEnums::BinaryExportSplit split = mSettings->mBinaryExportSplit;
+    if ((split == SerialAnalyzerEnums::FilePerAddress) && (mSettings->mSerialMode == SerialAnalyzerEnums::Normal)) {
+        split = SerialAnalyzerEnums::SingleFile;    //there are no addresses to split by.
+    }
+    bool multi_lane = mSettings->IsMultiLane();
+    if (multi_lane == true) {
+        split = SerialAnalyzerEnums::FilePerAddress;    //the lanes are independent streams, so each gets its own file.
+    }
+
+    std::auto_ptr< BinaryExportFile > single_file;
+    std::auto_ptr< BinaryExportFile > packet_file;
+    U64 packet_file_id = INVALID_RESULT_INDEX;
+    std::map< U64, BinaryExportFile * > address_files;
+    U64 address = 0;
+
+    if (split == SerialAnalyzerEnums::SingleFile) {
+        single_file.reset(new BinaryExportFile(file));  //create the file even if there is nothing to put in it.
+    }
+
+    U64 num_frames = GetNumFrames();
+    std::vector<Frame> lane_characters;     //multi-lane: the characters of every lane, not just the Data channel's frames
+    if (multi_lane == true) {
+        std::lock_guard<std::mutex> lock(mLaneCharactersMutex);
+        lane_characters = mLaneCharacters;
+        num_frames = lane_characters.size();
+    }
+    bool cancelled = false;
+
+    for (U64 i = 0; i < num_frames; i++) {
+        Frame frame = (multi_lane == true) ? lane_characters[i] : GetFrame(i);
+
+        if ((frame.mFlags & MP_MODE_ADDRESS_FLAG) != 0) {
+            address = frame.mData1;
+            continue;
+        }
+
+        if (frame.mType != SerialCharacterFrame) {
+            continue;   //the XMODEM decoder writes the block payloads itself
+        }
+
+        BinaryExportFile *f = NULL;
+
+        if ((split == SerialAnalyzerEnums::FilePerAddress) && (multi_lane == true)) {
+            BinaryExportFile *&lane_file = address_files[frame.mData2];
+            if (lane_file == NULL) {
+                std::stringstream ss;
+                ss << "lane_" << (frame.mData2 + 1);
+                lane_file = new BinaryExportFile(SplitFileName(file, ss.str()));
+            }
+            f = lane_file;
+        } else if (split == SerialAnalyzerEnums::FilePerAddress) {
+            BinaryExportFile *&address_file = address_files[address];
+            if (address_file == NULL) {
+                char address_str[128];
+                AnalyzerHelpers::GetNumberString(address, Hexadecimal, bits_per_transfer, address_str, 128);
+                address_file = new BinaryExportFile(SplitFileName(file, std::string("addr_") + address_str));
+            }
+            f = address_file;
+        } else if (split == SerialAnalyzerEnums::FilePerPacket) {
+            U64 packet_id = GetPacketContainingFrameSequential(i);
+            if (packet_id == INVALID_RESULT_INDEX) {
+                if (single_file.get() == NULL) {
+                    single_file.reset(new BinaryExportFile(file));
+                }
+                f = single_file.get();
+            } else {
+                if (packet_id != packet_file_id) {  //packets are sequential, so only one packet file is open at a time.
+                    std::stringstream ss;
+                    ss << "packet_" << packet_id;
+                    packet_file.reset(new BinaryExportFile(SplitFileName(file, ss.str())));
+                    packet_file_id = packet_id;
+                }
+                f = packet_file.get();
+            }
+        } else {
+            if (single_file.get() == NULL) {
+                single_file.reset(new BinaryExportFile(file));
+            }
+            f = single_file.get();
+        }
+
+        f->Append(frame.mData1, bytes_per_transfer);
+
+        if (((i & 0xFFFF) == 0) && (UpdateExportProgressAndCheckForCancel(i, num_frames) == true)) {
+            cancelled = true;
+            break;
+        }
+    }
+
+    for (std::map< U64, BinaryExportFile * >::iterator it = address_files.begin(); it != address_files.end(); ++it) {
+        delete it->second;
+    }
+
+    if (cancelled == false) {
+        UpdateExportProgressAndCheckForCancel(num_frames, num_frames);
+    }
+}
+
+void SerialAnalyzerResults::AddLaneCharacters(const std::vector<Frame> &characters)
+{
+    std::lock_guard<std::mutex> lock(mLaneCharactersMutex);
+    mLaneCharacters.insert(mLaneCharacters.end(), characters.begin(), characters.end());
+}
+
+U32 SerialAnalyzerResults::AddTextLineCharacter(U64 sample, U8 character)
+{
+    std::lock_guard<std::mutex> lock(mTextLinesMutex);
+
+    if (mTextLineOpen == false) {
+        SerialTextLine line;
+        line.mStartingSample = sample;
+        line.mTextOffset = mText.size();
+        line.mTextLength = 0;
+        mTextLines.push_back(line);
+        mTextLineOpen = true;
+    }
+
+    mText.push_back(char(character));
+    return ++mTextLines.back().mTextLength;
+}
+
+void SerialAnalyzerResults::EndTextLine(U64 sample)
+{
+    std::lock_guard<std::mutex> lock(mTextLinesMutex);
+
+    if (mTextLineOpen == false) {   //a terminator on its own is an empty line.
+        SerialTextLine line;
+        line.mStartingSample = sample;
+        line.mTextOffset = mText.size();
+        line.mTextLength = 0;
+        mTextLines.push_back(line);
+    }
+
+    mTextLineOpen = false;
+}
+
+void SerialAnalyzerResults::GenerateTextLineExportFile(const char *file)
+{
+    std::vector<SerialTextLine> lines;
+    std::string text;
+    {
+        std::lock_guard<std::mutex> lock(mTextLinesMutex);
+        lines = mTextLines;
+        text = mText;
+    }
+
+    U64 trigger_sample = mAnalyzer->GetTriggerSample();
+    U32 sample_rate = mAnalyzer->GetSampleRate();
+
+    void *f = AnalyzerHelpers::StartFile(file);
+
+    std::string buffer;
+    buffer.reserve(128 * 1024);
+    buffer += "Time [s],Packet ID,Line\n";
+
+    //every line is committed as its own packet, so the line index is the packet id.
+    U64 num_lines = lines.size();
+    for (U64 i = 0; i < num_lines; i++) {
+        const SerialTextLine &line = lines[i];
+
+        char time_str[128];
+        AnalyzerHelpers::GetTimeString(line.mStartingSample, trigger_sample, sample_rate, time_str, 128);
+
+        char index_str[32];
+        snprintf(index_str, sizeof(index_str), ",%llu,\"", i);
+
+        buffer += time_str;
+        buffer += index_str;
+
+        for (U32 j = 0; j < line.mTextLength; j++) {
+            U8 c = U8(text[line.mTextOffset + j]);
+            if (c == '"') {
+                buffer += "\"\"";
+            } else if ((c < 0x20) || (c >= 0x7F)) {
+                char escape_str[8];
+                snprintf(escape_str, sizeof(escape_str), "\\x%02X", c);
+                buffer += escape_str;
+            } else {
+                buffer += char(c);
+            }
+        }
+
+        buffer += "\"\n";
+
+        if (buffer.size() >= 64 * 1024) {
+            AnalyzerHelpers::AppendToFile((U8 *)buffer.c_str(), buffer.size(), f);
+            buffer.clear();
+
+            if (UpdateExportProgressAndCheckForCancel(i, num_lines) == true) {
+                AnalyzerHelpers::EndFile(f);
+                return;
+            }
+        }
+    }
+
+    AnalyzerHelpers::AppendToFile((U8 *)buffer.c_str(), buffer.size(), f);
+
+    UpdateExportProgressAndCheckForCancel(num_lines, num_lines);
+    AnalyzerHelpers::EndFile(f);
+}
+
+bool SerialAnalyzerResults::GetXmodemFrameText(const Frame &frame, char *result_str, U32 result_str_max_length)
+{
+    if (frame.mType == XmodemControlFrame) {
+        const char *name = "?";
+        switch (frame.mData1) {
+        case 0x04:
+            name = "EOT";
+            break;
+        case 0x06:
+            name = "ACK";
+            break;
+        case 0x15:
+            name = "NAK";
+            break;
+        case 0x18:
+            name = "CAN";
+            break;
+        case 'C':
+            name = "C (CRC-16 request)";
+            break;
+        }
+        snprintf(result_str, result_str_max_length, "%s", name);
+        return true;
+    }
+
+    if (frame.mType == XmodemBlockFrame) {
+        const char *status = "";
+        if ((frame.mFlags & XMODEM_CHECK_ERROR_FLAG) != 0) {
+            status = " (check error)";
+        } else if ((frame.mFlags & XMODEM_SEQUENCE_ERROR_FLAG) != 0) {
+            status = " (sequence error)";
+        } else if ((frame.mFlags & XMODEM_RETRANSMISSION_FLAG) != 0) {
+            status = " (retransmission)";
+        }
+
+        snprintf(result_str, result_str_max_length, "%s %u, %u bytes, %s%s",
+                 ((frame.mData2 & XMODEM_HEADER_BLOCK) != 0) ? "YMODEM header block" : "Block",
+                 U32(frame.mData1), U32(frame.mData2 & 0xFFFF),
+                 ((frame.mData2 & XMODEM_CRC16_BLOCK) != 0) ? "CRC-16" : "checksum", status);
+        return true;
+    }
+
+    return false;
+}
+
 void SerialAnalyzerResults::GenerateFrameTabularText(U64 frame_index, DisplayBase display_base)
 {
     ClearTabularText();
     Frame frame = GetFrame(frame_index);
 
+    char xmodem_str[128];
+    if (GetXmodemFrameText(frame, xmodem_str, sizeof(xmodem_str)) == true) {
+        AddTabularText(xmodem_str);
+        return;
+    }
+
     bool framing_error = false;
     if ((frame.mFlags & FRAMING_ERROR_FLAG) != 0) {
         framing_error = true;
@@ -228,6 +669,11 @@ void SerialAnalyzerResults::GenerateFrameTabularText(U64 frame_index, DisplayBas
         return;
     }
 
+    char lane_str[32] = "";
+    if (mSettings->IsMultiLane() == true) {    //name the lane, since the table mixes them
+        snprintf(lane_str, sizeof(lane_str), "Lane %u: ", U32(frame.mData2 + 1));
+    }
+
     //normal case:
     if ((parity_error == true) || (framing_error == true)) {
         if (parity_error == true && framing_error == false) {
@@ -238,10 +684,10 @@ void SerialAnalyzerResults::GenerateFrameTabularText(U64 frame_index, DisplayBas
             snprintf(result_str, sizeof(result_str), "%s (framing error & parity error)", number_str);
         }
 
-        AddTabularText(result_str);
+        AddTabularText(lane_str, result_str);
 
     } else {
-        AddTabularText(number_str);
+        AddTabularText(lane_str, number_str);
     }
 }
 
@@ -2,10 +2,39 @@
 #define SERIAL_ANALYZER_RESULTS
 
 #include <AnalyzerResults.h>
+#include <vector>
+#include <mutex>
 
 #define FRAMING_ERROR_FLAG ( 1 << 0 )
 #define PARITY_ERROR_FLAG ( 1 << 1 )
 #define MP_MODE_ADDRESS_FLAG ( 1 << 2 )
+#define XMODEM_CHECK_ERROR_FLAG ( 1 << 3 )
+#define XMODEM_SEQUENCE_ERROR_FLAG ( 1 << 4 )
+#define XMODEM_RETRANSMISSION_FLAG ( 1 << 5 )
+
+//XMODEM block frames: mData1 is the block number, mData2 the payload length plus these bits
+#define XMODEM_CRC16_BLOCK ( 1ull << 16 )
+#define XMODEM_HEADER_BLOCK ( 1ull << 17 )
+
+enum SerialFrameType { SerialCharacterFrame, XmodemBlockFrame, XmodemControlFrame };
+
+//counters for one window of the line statistics export
+struct SerialLineStatistics {
+    U64 mWindowStartingSample;
+    U64 mCharacters;
+    U64 mParityErrors;
+    U64 mFramingErrors;
+    U64 mBusySamples;       //nominal character time (start bit through stop bits) of every character in the window
+    U64 mBaudSamples;       //start-edge spacing of back-to-back characters...
+    U64 mBaudHalfBits;      //...and the number of half bit periods that spacing should span
+};
+
+//one CR/LF terminated line of the text mode; the characters are kept in SerialAnalyzerResults::mText
+struct SerialTextLine {
+    U64 mStartingSample;
+    U64 mTextOffset;
+    U32 mTextLength;
+};
 
 class SerialAnalyzer;
 class SerialAnalyzerSettings;
@@ -23,11 +52,34 @@ public:
     virtual void GeneratePacketTabularText(U64 packet_id, DisplayBase display_base);
     virtual void GenerateTransactionTabularText(U64 transaction_id, DisplayBase display_base);
 
+    void UpdateLineStatistics(const SerialLineStatistics &window);
+    U32 AddTextLineCharacter(U64 sample, U8 character);
+    void EndTextLine(U64 sample);
+    void AddLaneCharacters(const std::vector<Frame> &characters);
+
 protected: //functions
+    void GenerateStatisticsExportFile(const char *file);
+    void GenerateBinaryExportFile(const char *file);
+    void GenerateTextLineExportFile(const char *file);
+    bool GetXmodemFrameText(const Frame &frame, char *result_str, U32 result_str_max_length);
 
 protected:  //vars
     SerialAnalyzerSettings *mSettings;
     SerialAnalyzer *mAnalyzer;
+
+    //written by the worker thread, read by the export thread.
+    std::vector<SerialLineStatistics> mLineStatistics;
+    std::mutex mLineStatisticsMutex;
+
+    std::vector<SerialTextLine> mTextLines;
+    std::string mText;
+    bool mTextLineOpen;
+    std::mutex mTextLinesMutex;
+
+    //multi-lane mode: the characters of every lane, as character frames in start order. Only the Data channel's
+    //are added as frames too, since frames can't overlap.
+    std::vector<Frame> mLaneCharacters;
+    std::mutex mLaneCharactersMutex;
 };
 
 #endif //SERIAL_ANALYZER_RESULTS
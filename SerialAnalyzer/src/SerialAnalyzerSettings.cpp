@@ -3,10 +3,43 @@
 #include <AnalyzerHelpers.h>
 #include <sstream>
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
 
 #pragma warning(disable: 4800) //warning C4800: 'U32' : forcing value to bool 'true' or 'false' (performance warning)
 #define CHANNEL_NAME "Data"
 
+// 解析地址过滤列表，如 "0x12, 0x34"
+static bool ParseAddressFilter(const char *text, U32 address_bits, std::vector<U64> &addresses)
+{
+    addresses.clear();
+
+    const char *p = text;
+    for (; ;) {
+        while ((*p == ' ') || (*p == ',') || (*p == ';') || (*p == '\t')) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+
+        char *end;
+        U64 address = strtoull(p, &end, 0);
+        if (end == p) {
+            return false;
+        }
+        if ((address_bits < 64) && ((address >> address_bits) != 0)) {
+            return false;
+        }
+
+        addresses.push_back(address);
+        p = end;
+    }
+
+    std::sort(addresses.begin(), addresses.end());
+    return true;
+}
+
 SerialAnalyzerSettings::SerialAnalyzerSettings()
     :   mInputChannel(UNDEFINED_CHANNEL),
         mBitRate(9600),
@@ -16,13 +49,29 @@ SerialAnalyzerSettings::SerialAnalyzerSettings()
         mParity(AnalyzerEnums::None),
         mInverted(false),
         mUseAutobaud(false),
-        mSerialMode(SerialAnalyzerEnums::Normal)
+        mSerialMode(SerialAnalyzerEnums::Normal),
+        mStatisticsWindowMs(1000),
+        mBinaryExportSplit(SerialAnalyzerEnums::SingleFile),
+        mTextMode(false),
+        mXmodemMode(false)
 {
     // 通道接口初始化
     mInputChannelInterface.reset(new AnalyzerSettingInterfaceChannel());
     mInputChannelInterface->SetTitleAndTooltip(CHANNEL_NAME, "Standard Async Serial");      // 设置接口名和提示信息，鼠标移动到该接口会有提示信息
     mInputChannelInterface->SetChannel(mInputChannel);  // 设置通道
 
+    // 多路串口：与 Data 通道使用相同设置，一次遍历同时解析
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        std::stringstream ss;
+        ss << CHANNEL_NAME << " " << (i + 2);
+
+        mLaneChannels[i] = UNDEFINED_CHANNEL;
+        mLaneChannelInterfaces[i].reset(new AnalyzerSettingInterfaceChannel());
+        mLaneChannelInterfaces[i]->SetTitleAndTooltip(ss.str().c_str(), "Another serial line with the same settings, decoded in the same pass as the Data channel");
+        mLaneChannelInterfaces[i]->SetChannel(mLaneChannels[i]);
+        mLaneChannelInterfaces[i]->SetSelectionOfNoneIsAllowed(true);
+    }
+
     // 波特率输入框
     mBitRateInterface.reset(new AnalyzerSettingInterfaceInteger());
     mBitRateInterface->SetTitleAndTooltip("Bit Rate (Bits/s)",  "Specify the bit rate in bits per second.");        // 提示信息
@@ -93,7 +142,47 @@ SerialAnalyzerSettings::SerialAnalyzerSettings()
     mSerialModeInterface->AddNumber(SerialAnalyzerEnums::MpModeMsbOneMeansAddress, "MDB Mode: Address indicated by MSB=1", "(aka multi-drop, 9-bit serial)");
     mSerialModeInterface->SetNumber(mSerialMode);
 
+    // MP 模式地址过滤
+    mAddressFilterInterface.reset(new AnalyzerSettingInterfaceText());
+    mAddressFilterInterface->SetTitleAndTooltip("MP Address Filter", "MP mode only: comma separated list of the node addresses to decode data for (e.g. 0x12, 0x34). Leave empty to decode every node.");
+    mAddressFilterInterface->SetText(mAddressFilter.c_str());
+
+    // 文本行模式
+    mTextModeInterface.reset(new AnalyzerSettingInterfaceBool());
+    mTextModeInterface->SetTitleAndTooltip("", "Group the characters of each CR/LF terminated line into one packet, and export one row per line");
+    mTextModeInterface->SetCheckBoxText("Text Lines (ASCII consoles, AT, NMEA)");
+    mTextModeInterface->SetValue(mTextMode);
+
+    // XMODEM/YMODEM 文件传输解析
+    mXmodemModeInterface.reset(new AnalyzerSettingInterfaceBool());
+    mXmodemModeInterface->SetTitleAndTooltip("", "Decode XMODEM, XMODEM-CRC, XMODEM-1K and YMODEM blocks, and write the transferred files to the output folder");
+    mXmodemModeInterface->SetCheckBoxText("XMODEM/YMODEM Transfers");
+    mXmodemModeInterface->SetValue(mXmodemMode);
+
+    mXmodemOutputFolderInterface.reset(new AnalyzerSettingInterfaceText());
+    mXmodemOutputFolderInterface->SetTitleAndTooltip("XMODEM Output Folder", "Folder the files received over XMODEM/YMODEM are written to. Leave empty to only decode.");
+    mXmodemOutputFolderInterface->SetTextType(AnalyzerSettingInterfaceText::FolderPath);
+    mXmodemOutputFolderInterface->SetText(mXmodemOutputFolder.c_str());
+
+    // 线路统计窗口长度
+    mStatisticsWindowInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mStatisticsWindowInterface->SetTitleAndTooltip("Statistics Window (ms)", "Length of each window of the line statistics export (characters, errors, utilization and measured baud).");
+    mStatisticsWindowInterface->SetMax(3600000);
+    mStatisticsWindowInterface->SetMin(1);
+    mStatisticsWindowInterface->SetInteger(mStatisticsWindowMs);
+
+    // 二进制导出的文件拆分方式
+    mBinaryExportSplitInterface.reset(new AnalyzerSettingInterfaceNumberList());
+    mBinaryExportSplitInterface->SetTitleAndTooltip("Binary Export", "Specify how the raw binary payload export is split into files");
+    mBinaryExportSplitInterface->AddNumber(SerialAnalyzerEnums::SingleFile, "Single file", "");
+    mBinaryExportSplitInterface->AddNumber(SerialAnalyzerEnums::FilePerPacket, "One file per packet", "");
+    mBinaryExportSplitInterface->AddNumber(SerialAnalyzerEnums::FilePerAddress, "One file per MP address", "Only used in MP/MDB mode");
+    mBinaryExportSplitInterface->SetNumber(mBinaryExportSplit);
+
     AddInterface(mInputChannelInterface.get());
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        AddInterface(mLaneChannelInterfaces[i].get());
+    }
     AddInterface(mBitRateInterface.get());
     AddInterface(mUseAutobaudInterface.get());
     AddInterface(mInvertedInterface.get());
@@ -102,13 +191,28 @@ SerialAnalyzerSettings::SerialAnalyzerSettings()
     AddInterface(mParityInterface.get());
     AddInterface(mShiftOrderInterface.get());
     AddInterface(mSerialModeInterface.get());
+    AddInterface(mAddressFilterInterface.get());
+    AddInterface(mTextModeInterface.get());
+    AddInterface(mXmodemModeInterface.get());
+    AddInterface(mXmodemOutputFolderInterface.get());
+    AddInterface(mStatisticsWindowInterface.get());
+    AddInterface(mBinaryExportSplitInterface.get());
 
     AddExportOption(0, "Export as text/csv file");
     AddExportExtension(0, "Text file", "txt");
     AddExportExtension(0, "CSV file", "csv");
 
+    AddExportOption(1, "Export line statistics as csv file");
+    AddExportExtension(1, "CSV file", "csv");
+
+    AddExportOption(2, "Export payload as binary file");
+    AddExportExtension(2, "Binary file", "bin");
+
     ClearChannels();
     AddChannel(mInputChannel, CHANNEL_NAME, false);
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        AddChannel(mLaneChannels[i], mLaneChannelInterfaces[i]->GetTitle(), false);
+    }
 }
 
 SerialAnalyzerSettings::~SerialAnalyzerSettings()
@@ -117,11 +221,57 @@ SerialAnalyzerSettings::~SerialAnalyzerSettings()
 
 bool SerialAnalyzerSettings::SetSettingsFromInterfaces()
 {
+    std::vector<Channel> channels;
+    channels.push_back(mInputChannelInterface->GetChannel());
+    bool multi_lane = false;
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        channels.push_back(mLaneChannelInterfaces[i]->GetChannel());
+        if (channels.back() != UNDEFINED_CHANNEL) {
+            multi_lane = true;
+        }
+    }
+
+    if (AnalyzerHelpers::DoChannelsOverlap(&channels[0], channels.size()) == true) {
+        SetErrorText("Please select different channels for each input.");
+        return false;
+    }
+
+    if (multi_lane == true) {
+        if ((SerialAnalyzerEnums::Mode(U32(mSerialModeInterface->GetNumber())) != SerialAnalyzerEnums::Normal) || (mTextModeInterface->GetValue() == true) || (mXmodemModeInterface->GetValue() == true)) {
+            SetErrorText("More than one Data channel can only be used for plain characters, not with MP mode, text lines or XMODEM/YMODEM.");
+            return false;
+        }
+    }
+
     if (AnalyzerEnums::Parity(U32(mParityInterface->GetNumber())) != AnalyzerEnums::None)
         if (SerialAnalyzerEnums::Mode(U32(mSerialModeInterface->GetNumber())) != SerialAnalyzerEnums::Normal) {
             SetErrorText("Sorry, but we don't support using parity at the same time as MP mode.");
             return false;
         }
+
+    if ((mTextModeInterface->GetValue() == true) && (SerialAnalyzerEnums::Mode(U32(mSerialModeInterface->GetNumber())) != SerialAnalyzerEnums::Normal)) {
+        SetErrorText("Text lines can't be used at the same time as MP mode.");
+        return false;
+    }
+
+    if (mXmodemModeInterface->GetValue() == true) {
+        if ((mTextModeInterface->GetValue() == true) || (SerialAnalyzerEnums::Mode(U32(mSerialModeInterface->GetNumber())) != SerialAnalyzerEnums::Normal)) {
+            SetErrorText("XMODEM/YMODEM decoding can't be used at the same time as text lines or MP mode.");
+            return false;
+        }
+        if (U32(mBitsPerTransferInterface->GetNumber()) != 8) {
+            SetErrorText("XMODEM/YMODEM decoding needs 8 bits per transfer.");
+            return false;
+        }
+    }
+
+    U32 bits_per_transfer = U32(mBitsPerTransferInterface->GetNumber());
+    std::vector<U64> filter_addresses;
+    if (ParseAddressFilter(mAddressFilterInterface->GetText(), bits_per_transfer, filter_addresses) == false) {
+        SetErrorText("The MP address filter must be a comma separated list of addresses that fit in the selected number of bits.");
+        return false;
+    }
+
     mInputChannel = mInputChannelInterface->GetChannel();
     mBitRate = mBitRateInterface->GetInteger();
     mBitsPerTransfer = U32(mBitsPerTransferInterface->GetNumber());
@@ -131,9 +281,22 @@ bool SerialAnalyzerSettings::SetSettingsFromInterfaces()
     mInverted = mInvertedInterface->GetValue();
     mUseAutobaud = mUseAutobaudInterface->GetValue();
     mSerialMode = SerialAnalyzerEnums::Mode(U32(mSerialModeInterface->GetNumber()));
+    mStatisticsWindowMs = mStatisticsWindowInterface->GetInteger();
+    mBinaryExportSplit = SerialAnalyzerEnums::BinaryExportSplit(U32(mBinaryExportSplitInterface->GetNumber()));
+    mAddressFilter = mAddressFilterInterface->GetText();
+    mFilterAddresses = filter_addresses;
+    mTextMode = mTextModeInterface->GetValue();
+    mXmodemMode = mXmodemModeInterface->GetValue();
+    mXmodemOutputFolder = mXmodemOutputFolderInterface->GetText();
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        mLaneChannels[i] = mLaneChannelInterfaces[i]->GetChannel();
+    }
 
     ClearChannels();
     AddChannel(mInputChannel, CHANNEL_NAME, true);
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        AddChannel(mLaneChannels[i], mLaneChannelInterfaces[i]->GetTitle(), mLaneChannels[i] != UNDEFINED_CHANNEL);
+    }
 
     return true;
 }
@@ -149,6 +312,15 @@ void SerialAnalyzerSettings::UpdateInterfacesFromSettings()
     mInvertedInterface->SetValue(mInverted);
     mUseAutobaudInterface->SetValue(mUseAutobaud);
     mSerialModeInterface->SetNumber(mSerialMode);
+    mStatisticsWindowInterface->SetInteger(mStatisticsWindowMs);
+    mBinaryExportSplitInterface->SetNumber(mBinaryExportSplit);
+    mAddressFilterInterface->SetText(mAddressFilter.c_str());
+    mTextModeInterface->SetValue(mTextMode);
+    mXmodemModeInterface->SetValue(mXmodemMode);
+    mXmodemOutputFolderInterface->SetText(mXmodemOutputFolder.c_str());
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        mLaneChannelInterfaces[i]->SetChannel(mLaneChannels[i]);
+    }
 }
 
 void SerialAnalyzerSettings::LoadSettings(const char *settings)
@@ -181,8 +353,52 @@ void SerialAnalyzerSettings::LoadSettings(const char *settings)
         mSerialMode = mode;
     }
 
+    U32 statistics_window_ms;
+    if (text_archive >> statistics_window_ms) {
+        mStatisticsWindowMs = statistics_window_ms;
+    }
+
+    U32 binary_export_split;
+    if (text_archive >> binary_export_split) {
+        mBinaryExportSplit = SerialAnalyzerEnums::BinaryExportSplit(binary_export_split);
+    }
+
+    const char *address_filter;
+    if (text_archive >> &address_filter) {
+        if (ParseAddressFilter(address_filter, mBitsPerTransfer, mFilterAddresses) == true) {
+            mAddressFilter = address_filter;
+        } else {
+            mFilterAddresses.clear();
+        }
+    }
+
+    bool text_mode;
+    if (text_archive >> text_mode) {
+        mTextMode = text_mode;
+    }
+
+    bool xmodem_mode;
+    if (text_archive >> xmodem_mode) {
+        mXmodemMode = xmodem_mode;
+    }
+
+    const char *xmodem_output_folder;
+    if (text_archive >> &xmodem_output_folder) {
+        mXmodemOutputFolder = xmodem_output_folder;
+    }
+
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        Channel lane_channel;
+        if (text_archive >> lane_channel) {
+            mLaneChannels[i] = lane_channel;
+        }
+    }
+
     ClearChannels();
     AddChannel(mInputChannel, CHANNEL_NAME, true);
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        AddChannel(mLaneChannels[i], mLaneChannelInterfaces[i]->GetTitle(), mLaneChannels[i] != UNDEFINED_CHANNEL);
+    }
 
     UpdateInterfacesFromSettings();
 }
@@ -201,6 +417,44 @@ const char *SerialAnalyzerSettings::SaveSettings()
     text_archive << mInverted;
     text_archive << mUseAutobaud;
     text_archive << mSerialMode;
+    text_archive << mStatisticsWindowMs;
+    text_archive << mBinaryExportSplit;
+    text_archive << mAddressFilter.c_str();
+    text_archive << mTextMode;
+    text_archive << mXmodemMode;
+    text_archive << mXmodemOutputFolder.c_str();
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        text_archive << mLaneChannels[i];
+    }
 
     return SetReturnString(text_archive.GetString());
 }
+
+bool SerialAnalyzerSettings::IsAddressSelected(U64 address) const
+{
+    if (mFilterAddresses.empty() == true) {
+        return true;
+    }
+
+    return std::binary_search(mFilterAddresses.begin(), mFilterAddresses.end(), address);
+}
+
+bool SerialAnalyzerSettings::IsMultiLane() const
+{
+    for (U32 i = 0; i < SERIAL_MAX_LANES - 1; i++) {
+        if (mLaneChannels[i] != UNDEFINED_CHANNEL) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Channel SerialAnalyzerSettings::GetLaneChannel(U32 lane) const
+{
+    if (lane == 0) {
+        return mInputChannel;
+    }
+
+    return mLaneChannels[lane - 1];
+}
@@ -4,9 +4,12 @@
 #include <AnalyzerSettings.h>
 #include <AnalyzerTypes.h>
 
+#define SERIAL_MAX_LANES 16                     // the Data channel plus up to 15 more lines decoded in the same pass
+
 namespace SerialAnalyzerEnums
 {
     enum Mode { Normal, MpModeMsbZeroMeansAddress, MpModeMsbOneMeansAddress };
+    enum BinaryExportSplit { SingleFile, FilePerPacket, FilePerAddress };
 };
 
 class SerialAnalyzerSettings : public AnalyzerSettings
@@ -30,6 +33,18 @@ public:
     bool mInverted;                             // 򣬵ߵ
     bool mUseAutobaud;                          // ǷԶʼ
     SerialAnalyzerEnums::Mode mSerialMode;
+    U32 mStatisticsWindowMs;                    // line statistics window length, in ms
+    SerialAnalyzerEnums::BinaryExportSplit mBinaryExportSplit;  // how the raw binary export is split into files
+    std::string mAddressFilter;                 // MP mode: addresses to decode data for, empty for all
+    std::vector<U64> mFilterAddresses;          // parsed mAddressFilter, sorted
+    bool mTextMode;                             // group characters into CR/LF terminated text lines
+    bool mXmodemMode;                           // decode XMODEM/YMODEM blocks
+    std::string mXmodemOutputFolder;            // where the transferred files are written, empty to only decode
+    Channel mLaneChannels[SERIAL_MAX_LANES - 1];   // more lines with the same settings, UNDEFINED_CHANNEL if unused
+
+    bool IsAddressSelected(U64 address) const;
+    bool IsMultiLane() const;
+    Channel GetLaneChannel(U32 lane) const;     // lane 0 is the Data channel
 
 protected:
     std::auto_ptr< AnalyzerSettingInterfaceChannel >    mInputChannelInterface;     // ͨӿ
@@ -41,6 +56,13 @@ protected:
     std::auto_ptr< AnalyzerSettingInterfaceBool >   mInvertedInterface;             // ѡǷ򣨽RS232
     std::auto_ptr< AnalyzerSettingInterfaceBool >   mUseAutobaudInterface;          // ѡǷԶ
     std::auto_ptr< AnalyzerSettingInterfaceNumberList > mSerialModeInterface;       // б
+    std::auto_ptr< AnalyzerSettingInterfaceInteger >    mStatisticsWindowInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceNumberList > mBinaryExportSplitInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceText >       mAddressFilterInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceBool >       mTextModeInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceBool >       mXmodemModeInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceText >       mXmodemOutputFolderInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceChannel >    mLaneChannelInterfaces[SERIAL_MAX_LANES - 1];
 };
 
 #endif //SERIAL_ANALYZER_SETTINGS
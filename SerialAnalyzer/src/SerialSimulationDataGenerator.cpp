@@ -1,5 +1,6 @@
 #include "SerialSimulationDataGenerator.h"
 #include "SerialAnalyzerSettings.h"
+#include <sstream>
 
 SerialSimulationDataGenerator::SerialSimulationDataGenerator()
 {
@@ -55,7 +56,22 @@ U32 SerialSimulationDataGenerator::GenerateSimulationData(U64 largest_sample_req
     U64 adjusted_largest_sample_requested = AnalyzerHelpers::AdjustSimulationTargetSample(largest_sample_requested, sample_rate, mSimulationSampleRateHz);
 
     while (mSerialSimulationData.GetCurrentSampleNumber() < adjusted_largest_sample_requested) {
-        if (mSettings->mSerialMode == SerialAnalyzerEnums::Normal) {
+        if (mSettings->mXmodemMode == true) {
+            CreateXmodemBlock();
+
+            mSerialSimulationData.Advance(mClockGenerator.AdvanceByHalfPeriod(40.0));     //insert 40 bit-periods of idle, where the receiver's ACK would go
+        } else if (mSettings->mTextMode == true) {
+            std::stringstream ss;
+            ss << "Line " << mValue++ << ": KingstVIS Serial text mode\r\n";
+            std::string line = ss.str();
+
+            for (U32 i = 0; i < line.size(); i++) {
+                CreateSerialByte(U8(line[i]));
+                mSerialSimulationData.Advance(mClockGenerator.AdvanceByHalfPeriod(1.0));  //insert 1 bit-period of idle
+            }
+
+            mSerialSimulationData.Advance(mClockGenerator.AdvanceByHalfPeriod(20.0));     //insert 20 bit-periods of idle
+        } else if (mSettings->mSerialMode == SerialAnalyzerEnums::Normal) {
             CreateSerialByte(mValue++);
 
             mSerialSimulationData.Advance(mClockGenerator.AdvanceByHalfPeriod(10.0));     //insert 10 bit-periods of idle
@@ -139,3 +155,37 @@ void SerialSimulationDataGenerator::CreateSerialByte(U64 value)
     //lets pad the end a bit for the stop bit:
     mSerialSimulationData.Advance(mClockGenerator.AdvanceByHalfPeriod(mSettings->mStopBits));
 }
+
+void SerialSimulationDataGenerator::CreateXmodemBlock()
+{
+    //XMODEM-CRC: eight 128 byte blocks, then EOT, then the next transfer starts over at block 1
+    U32 block_index = U32(mValue++ % 9);
+
+    if (block_index == 8) {
+        CreateSerialByte(0x04);  //EOT
+        return;
+    }
+
+    U8 block_number = U8(block_index + 1);
+    U8 payload[128];
+    for (U32 i = 0; i < 128; i++) {
+        payload[i] = U8(block_index * 128 + i);
+    }
+
+    U16 crc = 0;
+    for (U32 i = 0; i < 128; i++) {
+        crc ^= U16(payload[i] << 8);
+        for (U32 j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? U16((crc << 1) ^ 0x1021) : U16(crc << 1);
+        }
+    }
+
+    CreateSerialByte(0x01);  //SOH
+    CreateSerialByte(block_number);
+    CreateSerialByte(U8(~block_number));
+    for (U32 i = 0; i < 128; i++) {
+        CreateSerialByte(payload[i]);
+    }
+    CreateSerialByte(crc >> 8);
+    CreateSerialByte(crc & 0xFF);
+}
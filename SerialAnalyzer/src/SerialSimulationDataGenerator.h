@@ -28,6 +28,7 @@ protected:
 protected: //Serial specific
 
     void CreateSerialByte(U64 value);
+    void CreateXmodemBlock();
     ClockGenerator mClockGenerator;
     SimulationChannelDescriptor mSerialSimulationData;  //if we had more than one channel to simulate, they would need to be in an array
 };
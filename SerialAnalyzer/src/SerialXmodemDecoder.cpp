@@ -0,0 +1,366 @@
+#include "SerialXmodemDecoder.h"
+#include "SerialAnalyzerResults.h"
+#include "SerialAnalyzerSettings.h"
+#include <AnalyzerHelpers.h>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+
+#define XMODEM_SOH 0x01
+#define XMODEM_STX 0x02
+#define XMODEM_EOT 0x04
+#define XMODEM_ACK 0x06
+#define XMODEM_NAK 0x15
+#define XMODEM_CAN 0x18
+#define XMODEM_CRC_REQUEST 'C'
+
+SerialXmodemDecoder::SerialXmodemDecoder()
+    :   mResults(NULL),
+        mSettings(NULL),
+        mBlockTimeoutSamples(0),
+        mCheckType(CheckUnknown),
+        mInTransfer(false),
+        mLastGoodBlock(0),
+        mTransferCount(0),
+        mFile(NULL),
+        mFileBytesRemaining(0),
+        mFileSizeKnown(false)
+{
+    //CRC-16/XMODEM: polynomial 0x1021, initial value 0, MSB first.
+    for (U32 i = 0; i < 256; i++) {
+        U16 crc = U16(i << 8);
+        for (U32 j = 0; j < 8; j++) {
+            if ((crc & 0x8000) != 0) {
+                crc = U16((crc << 1) ^ 0x1021);
+            } else {
+                crc = U16(crc << 1);
+            }
+        }
+        mCrcTable[i] = crc;
+    }
+}
+
+SerialXmodemDecoder::~SerialXmodemDecoder()
+{
+    EndFile();
+}
+
+void SerialXmodemDecoder::Reset(SerialAnalyzerResults *results, SerialAnalyzerSettings *settings, U32 sample_rate_hz)
+{
+    EndFile();
+
+    mResults = results;
+    mSettings = settings;
+    mBlockTimeoutSamples = sample_rate_hz;  //the protocol allows one second between the characters of a block
+
+    mBlock.clear();
+    mPending.clear();
+    mCheckType = CheckUnknown;
+    mInTransfer = false;
+    mLastGoodBlock = 0;
+    mTransferCount = 0;
+}
+
+void SerialXmodemDecoder::AddCharacter(const SerialCharacter &character)
+{
+    mPending.push_back(character);
+
+    while (mPending.empty() == false) {
+        SerialCharacter next = mPending.front();
+        mPending.pop_front();
+        ProcessCharacter(next);
+    }
+}
+
+//a block that only waits for the character that tells a checksum from a CRC is taken as a checksum block;
+//any other unfinished block is reported as characters, like one that timed out.
+void SerialXmodemDecoder::EndOfData()
+{
+    while (mBlock.empty() == false) {
+        U32 payload_length = (mBlock[0].mValue == XMODEM_STX) ? 1024 : 128;
+        if ((mBlock.size() == 3 + payload_length + 1) && (mCheckType != CheckCrc16)) {
+            CompleteBlock();
+        } else {
+            AbandonBlock();
+        }
+
+        while (mPending.empty() == false) {
+            SerialCharacter next = mPending.front();
+            mPending.pop_front();
+            ProcessCharacter(next);
+        }
+    }
+
+    if (mFile != NULL) {
+        fflush(mFile);
+    }
+}
+
+void SerialXmodemDecoder::ProcessCharacter(const SerialCharacter &character)
+{
+    if ((mBlock.empty() == false) && ((character.mStartingSampleInclusive - mBlock.back().mEndingSampleInclusive) > mBlockTimeoutSamples)) {
+        mPending.push_front(character);
+        AbandonBlock();
+        return;
+    }
+
+    if (mBlock.empty() == true) {
+        switch (character.mValue) {
+        case XMODEM_SOH:
+        case XMODEM_STX:
+            mBlock.push_back(character);
+            break;
+
+        case XMODEM_EOT:
+            AddControlFrame(character);
+            if (mInTransfer == true) {
+                EndFile();
+                mInTransfer = false;
+                mCheckType = CheckUnknown;
+                mTransferCount++;
+            }
+            break;
+
+        case XMODEM_ACK:
+        case XMODEM_NAK:
+        case XMODEM_CAN:
+        case XMODEM_CRC_REQUEST:
+            AddControlFrame(character);
+            break;
+
+        default:
+            AddCharacterFrame(character);
+            break;
+        }
+        return;
+    }
+
+    mBlock.push_back(character);
+
+    //the block number is followed by its one's complement; if it isn't, this wasn't a block after all.
+    if (mBlock.size() == 3) {
+        if (U8(mBlock[1].mValue + mBlock[2].mValue) != 0xFF) {
+            AbandonBlock();
+        }
+        return;
+    }
+
+    U32 payload_length = (mBlock[0].mValue == XMODEM_STX) ? 1024 : 128;
+    U32 checksum_block_length = 3 + payload_length + 1;
+
+    if ((mBlock.size() == checksum_block_length) && (mCheckType == CheckSum)) {
+        CompleteBlock();
+    } else if (mBlock.size() == checksum_block_length + 1) {
+        CompleteBlock();
+    }
+}
+
+void SerialXmodemDecoder::CompleteBlock()
+{
+    U32 payload_length = (mBlock[0].mValue == XMODEM_STX) ? 1024 : 128;
+
+    std::vector<U8> payload(payload_length);
+    U8 checksum = 0;
+    U8 character_flags = 0;
+    for (U32 i = 0; i < payload_length; i++) {
+        payload[i] = mBlock[3 + i].mValue;
+        checksum += payload[i];
+    }
+    for (U32 i = 0; i < mBlock.size(); i++) {
+        character_flags |= mBlock[i].mFlags & (FRAMING_ERROR_FLAG | PARITY_ERROR_FLAG);
+    }
+
+    bool check_ok = false;
+    bool is_crc = true;
+
+    if ((mCheckType == CheckSum) || (mBlock.size() == 3 + payload_length + 1)) {
+        is_crc = false;
+        check_ok = (mBlock[3 + payload_length].mValue == checksum);
+    } else {
+        U16 crc = U16((mBlock[3 + payload_length].mValue << 8) | mBlock[4 + payload_length].mValue);
+        check_ok = (ComputeCrc16(&payload[0], payload_length) == crc);
+
+        //until a transfer has settled on a check type, a bad CRC may just mean the block ended one character earlier.
+        if ((check_ok == false) && (mCheckType == CheckUnknown) && (mBlock[3 + payload_length].mValue == checksum)) {
+            mPending.push_front(mBlock.back());
+            mBlock.pop_back();
+            is_crc = false;
+            check_ok = true;
+        }
+    }
+
+    U8 block_number = mBlock[1].mValue;
+    U8 flags = character_flags;
+    bool is_header = false;
+
+    if ((check_ok == false) || (character_flags != 0)) {
+        flags |= XMODEM_CHECK_ERROR_FLAG | DISPLAY_AS_ERROR_FLAG;
+    } else {
+        if (mCheckType == CheckUnknown) {
+            mCheckType = is_crc ? CheckCrc16 : CheckSum;
+        }
+
+        if (mInTransfer == false) {
+            if (block_number == 0) {
+                //YMODEM header: "name\0size ...", an empty name ends the batch.
+                is_header = true;
+                std::string name(reinterpret_cast<const char *>(&payload[0]), strnlen(reinterpret_cast<const char *>(&payload[0]), payload_length));
+                if (name.empty() == false) {
+                    mInTransfer = true;
+                    mLastGoodBlock = 0;
+
+                    //the size field may run to the end of the block, so convert a copy that ends where the payload does
+                    std::string size_str;
+                    if (name.size() + 1 < payload_length) {
+                        size_str.assign(reinterpret_cast<const char *>(&payload[0]) + name.size() + 1, payload_length - name.size() - 1);
+                    }
+                    mFileSizeKnown = (size_str.empty() == false) && (size_str[0] >= '0') && (size_str[0] <= '9');
+                    mFileBytesRemaining = mFileSizeKnown ? strtoull(size_str.c_str(), NULL, 10) : 0;
+
+                    std::string::size_type slash = name.find_last_of("/\\");
+                    if (slash != std::string::npos) {
+                        name = name.substr(slash + 1);
+                    }
+                    for (U32 i = 0; i < name.size(); i++) {
+                        char c = name[i];
+                        if (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9')) || (c == '.') || (c == '-') || (c == '_')) {
+                            continue;
+                        }
+                        name[i] = '_';
+                    }
+                    StartFile(name);
+                }
+            } else if (block_number == 1) {
+                mInTransfer = true;
+                mFileSizeKnown = false;
+
+                std::stringstream ss;
+                ss << "xmodem_" << mTransferCount << ".bin";
+                StartFile(ss.str());
+
+                WriteBlock(&payload[0], payload_length);
+                mLastGoodBlock = block_number;
+            } else {
+                flags |= XMODEM_SEQUENCE_ERROR_FLAG | DISPLAY_AS_ERROR_FLAG;
+            }
+        } else if (block_number == mLastGoodBlock) {
+            flags |= XMODEM_RETRANSMISSION_FLAG | DISPLAY_AS_ERROR_FLAG;
+        } else if (block_number == U8(mLastGoodBlock + 1)) {
+            WriteBlock(&payload[0], payload_length);
+            mLastGoodBlock = block_number;
+        } else {
+            flags |= XMODEM_SEQUENCE_ERROR_FLAG | DISPLAY_AS_ERROR_FLAG;
+        }
+    }
+
+    AddBlockFrame(block_number, payload_length, is_crc, is_header, flags);
+    mBlock.clear();
+}
+
+void SerialXmodemDecoder::AbandonBlock()
+{
+    //report the SOH/STX as an ordinary character, and look at everything after it again.
+    for (size_t i = mBlock.size() - 1; i >= 1; i--) {
+        mPending.push_front(mBlock[i]);
+    }
+    AddCharacterFrame(mBlock[0]);
+    mBlock.clear();
+}
+
+void SerialXmodemDecoder::AddCharacterFrame(const SerialCharacter &character)
+{
+    Frame frame;
+    frame.mStartingSampleInclusive = character.mStartingSampleInclusive;
+    frame.mEndingSampleInclusive = character.mEndingSampleInclusive;
+    frame.mData1 = character.mValue;
+    frame.mData2 = 0;
+    frame.mType = SerialCharacterFrame;
+    frame.mFlags = character.mFlags;
+    mResults->AddFrame(frame);
+}
+
+void SerialXmodemDecoder::AddControlFrame(const SerialCharacter &character)
+{
+    Frame frame;
+    frame.mStartingSampleInclusive = character.mStartingSampleInclusive;
+    frame.mEndingSampleInclusive = character.mEndingSampleInclusive;
+    frame.mData1 = character.mValue;
+    frame.mData2 = 0;
+    frame.mType = XmodemControlFrame;
+    frame.mFlags = character.mFlags;
+    if ((character.mValue == XMODEM_NAK) || (character.mValue == XMODEM_CAN)) {
+        frame.mFlags |= DISPLAY_AS_ERROR_FLAG;
+    }
+    mResults->AddFrame(frame);
+}
+
+void SerialXmodemDecoder::AddBlockFrame(U8 block_number, U32 payload_length, bool is_crc, bool is_header, U8 flags)
+{
+    Frame frame;
+    frame.mStartingSampleInclusive = mBlock.front().mStartingSampleInclusive;
+    frame.mEndingSampleInclusive = mBlock.back().mEndingSampleInclusive;
+    frame.mData1 = block_number;
+    frame.mData2 = payload_length;
+    if (is_crc == true) {
+        frame.mData2 |= XMODEM_CRC16_BLOCK;
+    }
+    if (is_header == true) {
+        frame.mData2 |= XMODEM_HEADER_BLOCK;
+    }
+    frame.mType = XmodemBlockFrame;
+    frame.mFlags = flags;
+
+    mResults->CommitPacketAndStartNewPacket();
+    mResults->AddFrame(frame);
+    mResults->CommitPacketAndStartNewPacket();
+}
+
+void SerialXmodemDecoder::WriteBlock(const U8 *payload, U32 length)
+{
+    if (mFile == NULL) {
+        return;
+    }
+
+    if (mFileSizeKnown == true) {   //YMODEM: drop the padding of the last block
+        if (length > mFileBytesRemaining) {
+            length = U32(mFileBytesRemaining);
+        }
+        mFileBytesRemaining -= length;
+    }
+
+    fwrite(payload, 1, length, mFile);
+}
+
+void SerialXmodemDecoder::StartFile(const std::string &file_name)
+{
+    EndFile();
+
+    std::string folder = mSettings->mXmodemOutputFolder;
+    if (folder.empty() == true) {
+        return;     //decode only
+    }
+
+    char last = folder[folder.size() - 1];
+    if ((last != '/') && (last != '\\')) {
+        folder += '/';
+    }
+
+    mFile = fopen((folder + file_name).c_str(), "wb");
+}
+
+void SerialXmodemDecoder::EndFile()
+{
+    if (mFile != NULL) {
+        fclose(mFile);
+        mFile = NULL;
+    }
+}
+
+U16 SerialXmodemDecoder::ComputeCrc16(const U8 *data, U32 length) const
+{
+    U16 crc = 0;
+    for (U32 i = 0; i < length; i++) {
+        crc = U16((crc << 8) ^ mCrcTable[((crc >> 8) ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
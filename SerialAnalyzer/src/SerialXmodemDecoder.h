@@ -0,0 +1,66 @@
+#ifndef SERIAL_XMODEM_DECODER
+#define SERIAL_XMODEM_DECODER
+
+#include <LogicPublicTypes.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdio>
+
+class SerialAnalyzerResults;
+class SerialAnalyzerSettings;
+
+//one decoded character, as handed over by SerialAnalyzer::WorkerThread
+struct SerialCharacter {
+    U64 mStartingSampleInclusive;
+    U64 mEndingSampleInclusive;
+    U8 mValue;
+    U8 mFlags;
+};
+
+//Turns the character stream of one side of an XMODEM / XMODEM-CRC / XMODEM-1K / YMODEM transfer into
+//block and control frames, and writes the payload of every good block to the output folder as it goes.
+class SerialXmodemDecoder
+{
+public:
+    SerialXmodemDecoder();
+    ~SerialXmodemDecoder();
+
+    void Reset(SerialAnalyzerResults *results, SerialAnalyzerSettings *settings, U32 sample_rate_hz);
+    void AddCharacter(const SerialCharacter &character);
+    void EndOfData();   //nothing more has been captured: don't hold back the characters of an unfinished block
+
+protected: //functions
+    void ProcessCharacter(const SerialCharacter &character);
+    void CompleteBlock();
+    void AbandonBlock();
+    void AddCharacterFrame(const SerialCharacter &character);
+    void AddControlFrame(const SerialCharacter &character);
+    void AddBlockFrame(U8 block_number, U32 payload_length, bool is_crc, bool is_header, U8 flags);
+    void WriteBlock(const U8 *payload, U32 length);
+    void StartFile(const std::string &file_name);
+    void EndFile();
+    U16 ComputeCrc16(const U8 *data, U32 length) const;
+
+protected: //vars
+    SerialAnalyzerResults *mResults;
+    SerialAnalyzerSettings *mSettings;
+    U16 mCrcTable[256];
+    U64 mBlockTimeoutSamples;                   //a gap this long inside a block means the sender gave up on it
+
+    std::vector<SerialCharacter> mBlock;        //characters of the block being collected, starting with SOH/STX
+    std::deque<SerialCharacter> mPending;       //characters to feed through again after a block turned out not to be one
+
+    enum CheckType { CheckUnknown, CheckCrc16, CheckSum };
+    CheckType mCheckType;                       //settles on the first good block of a transfer
+
+    bool mInTransfer;
+    U8 mLastGoodBlock;
+    U32 mTransferCount;
+
+    FILE *mFile;
+    U64 mFileBytesRemaining;                    //YMODEM: the size from the header block, so the padding can be dropped
+    bool mFileSizeKnown;
+};
+
+#endif //SERIAL_XMODEM_DECODER
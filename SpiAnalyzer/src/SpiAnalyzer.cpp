@@ -2,6 +2,60 @@
 #include "SpiAnalyzer.h"
 #include "SpiAnalyzerSettings.h"
 #include <AnalyzerChannelData.h>
+#include <cstring>
+
+namespace
+{
+    //lines used by the command, address and data phases, indexed by SpiAnalyzerEnums::LaneMode
+    struct SpiLaneWidths {
+        U32 mCommand;
+        U32 mAddress;
+        U32 mData;
+        bool mDtr;      //the multi-line phases are sampled on both clock edges
+    };
+
+    const SpiLaneWidths LANE_WIDTHS[] = {
+        { 1, 1, 1, false },     //SingleLane
+        { 1, 1, 2, false },     //Dual112
+        { 1, 2, 2, false },     //Dual122
+        { 1, 1, 4, false },     //Quad114
+        { 1, 4, 4, false },     //Quad144
+        { 4, 4, 4, false },     //Quad444
+        { 1, 1, 8, false },     //Octal118
+        { 1, 8, 8, false },     //Octal188
+        { 8, 8, 8, false },     //Octal888
+        { 8, 8, 8, true },      //Octal888Dtr
+    };
+
+    //shifts a bit into a word the way DataBuilder does; BIT_HIGH is 1
+    template <AnalyzerEnums::ShiftOrder SHIFT_ORDER>
+    inline void AddBit(U64 &word, U32 index, BitState bit)
+    {
+        if (SHIFT_ORDER == AnalyzerEnums::MsbFirst) {
+            word = (word << 1) | U64(bit);
+        } else {
+            word |= U64(bit) << index;
+        }
+    }
+
+    void AddTimingValue(SpiTimingHistogram &histogram, U64 samples)
+    {
+        if ((histogram.mCount == 0) || (samples < histogram.mMinimum)) {
+            histogram.mMinimum = samples;
+        }
+        if (samples > histogram.mMaximum) {
+            histogram.mMaximum = samples;
+        }
+        histogram.mCount++;
+        histogram.mTotal += samples;
+
+        U32 bin = 0;
+        while ((bin < 63) && ((samples >> (bin + 1)) != 0)) {
+            bin++;
+        }
+        histogram.mBins[bin]++;
+    }
+}
 
 SpiAnalyzer::SpiAnalyzer()
     :   Analyzer(),
@@ -10,8 +64,58 @@ SpiAnalyzer::SpiAnalyzer()
         mMosi(NULL),
         mMiso(NULL),
         mClock(NULL),
-        mEnable(NULL)
+        mEnable(NULL),
+        mMultiSlave(false),
+        mSlave(0),
+        mDqs(NULL),
+        mDtr(false),
+        mLaneLevels(0),
+        mLaneSample(0),
+        mDc(NULL),
+        mPhase(CommandPhase),
+        mCommandLanes(1),
+        mAddressLanes(1),
+        mDataLanes(1),
+        mPhaseAddressBytes(0),
+        mPhaseDummyClocks(0),
+        mNorCommand(NULL),
+        mNorAddress(0),
+        mDataIndex(0),
+        mEnableDeassertSample(0),
+        mEnableDeassertKnown(false),
+        mClockIdleTimeoutSamples(0),
+        mClockIdleSample(0),
+        mWordReader(&SpiAnalyzer::GetWord),
+        mUncommittedFrames(0),
+        mTransactionFirstWord(0),
+        mTransactionWords(0),
+        mTransactionStartingSample(0),
+        mTransactionEndingSample(0),
+        mTransactionNorMismatch(false),
+        mAssertSample(0),
+        mTimingWords(0),
+        mTimingLastEdge(0),
+        mTimingSpanSamples(0),
+        mTimingHalfPeriods(0),
+        mRepeatSlave(0),
+        mRepeatCount(0),
+        mRepeatEndingSample(0),
+        mRepeatFirstWord(0),
+        mAssertionFirstPayloadWord(0),
+        mAssertionStartingSample(0),
+        mAssertionEndingSample(0),
+        mAssertionRepeating(false),
+        mDetecting(false),
+        mDetectAssertions(0),
+        mDetectClocks(0),
+        mDetectPartialAssertion(false),
+        mIndependentLines(0)
 {
+    memset(mTiming, 0, sizeof(mTiming));
+    memset(mLaneNextEdge, 0, sizeof(mLaneNextEdge));
+    memset(mDetectIdleLevels, 0, sizeof(mDetectIdleLevels));
+    memset(mDetectValidEdges, 0, sizeof(mDetectValidEdges));
+    memset(mLineWords, 0, sizeof(mLineWords));
     SetAnalyzerSettings(mSettings.get());
 }
 
@@ -31,16 +135,65 @@ void SpiAnalyzer::SetupResults()
     if (mSettings->mMisoChannel != UNDEFINED_CHANNEL) {
         mResults->AddChannelBubblesWillAppearOn(mSettings->mMisoChannel);
     }
+    if (mSettings->mIndependentLines == true) {     //every line shows its own word
+        for (U32 i = 2; i < SPI_MAX_LANES; i++) {
+            if (mSettings->GetIoChannel(i) != UNDEFINED_CHANNEL) {
+                mResults->AddChannelBubblesWillAppearOn(mSettings->GetIoChannel(i));
+            }
+        }
+    }
 }
 
 void SpiAnalyzer::WorkerThread()
 {
     Setup();
+    mEnableDeassertKnown = false;
+    mTransactionWords = 0;
+    mTransactionNorMismatch = false;
+    mUncommittedFrames = 0;
+    ResetPhases();
+
+    mLaneLevels = 0;
+    mLaneSample = 0;
+    memset(mLaneNextEdge, 0, sizeof(mLaneNextEdge));    //every line is read on its first sample
+
+    memset(mTiming, 0, sizeof(mTiming));
+    mTimingWords = 0;
+    mTimingSpanSamples = 0;
+    mTimingHalfPeriods = 0;
+    mResults->UpdateTimingStatistics(mTiming);
+
+    for (U32 i = 0; i < SPI_MAX_SLAVES; i++) {
+        mSdCards[i].Reset(mResults.get());
+        mDisplays[i].Reset(mResults.get(), mMiso != NULL);
+        mFlashImages[i].Reset();
+    }
+    mDecodedFrames.clear();
+
+    mDetectAssertions = 0;
+    mDetectIdleLevels[0] = 0;
+    mDetectIdleLevels[1] = 0;
+    mDetectValidEdges[0] = 0;
+    mDetectValidEdges[1] = 0;
+    mDetectClocks = 0;
+    mDetectAssertionClocks.clear();
+
+    mRepeatWords.clear();
+    mRepeatCount = 0;
+    mRepeatStartingSamples.clear();
+    mAssertionWords.clear();
+    mAssertionRepeating = false;
+    mHeldFrames.clear();
+    mHeldMarkers.clear();
 
     mResults->CommitPacketAndStartNewPacket();
     mResults->CommitResults();
 
-    if (mEnable != NULL) {
+    U64 capture_start_sample = mClock->GetSampleNumber();
+    if (mMultiSlave == true) {
+        mCurrentSample = mClock->GetSampleNumber();
+        AdvanceToNextSlaveAssertion(true);
+    } else if (mEnable != NULL) {
         if (mEnable->GetBitState() != mSettings->mEnableActiveState) {
             mEnable->AdvanceToNextEdge();
         }
@@ -51,22 +204,45 @@ void SpiAnalyzer::WorkerThread()
         mCurrentSample = mClock->GetSampleNumber();
     }
 
+    //an assertion already under way when the capture started is only partly in it, so the detection leaves it out
+    mDetectPartialAssertion = (mEnable != NULL) && (mCurrentSample == capture_start_sample);
+
     for (; ;) {
         if (IsInitialClockPolarityCorrect() == true) { //if false, this function moves to the next active enable edge.
             break;
         }
     }
+    mAssertSample = mCurrentSample;
+
+    mClockIdleSample = mClock->GetSampleNumber();     //a packet has just been started
 
     for (; ;) {
-        GetWord();
+        (this->*mWordReader)();
         CheckIfThreadShouldExit();
     }
 }
 
 void SpiAnalyzer::AdvanceToActiveEnableEdgeWithCorrectClockPolarity()
 {
-    mResults->CommitPacketAndStartNewPacket();
+    if (mSettings->mSdCard == true) {
+        mSdCards[mSlave].EndTransaction(mDecodedFrames);
+        AddDecodedFrames();
+    } else if (mSettings->mDisplay == true) {
+        mDisplays[mSlave].EndTransaction(mDecodedFrames);
+        AddDecodedFrames();
+    }
+
+    EndTransactionTiming();
+    EndTransaction();
+    ResetPhases();
+    if (mDetecting == true) {
+        EndDetectAssertion();
+    }
+    if (EndRepeatAssertion() == false) {    //a repeat has no frames of its own
+        mResults->CommitPacketAndStartNewPacket();
+    }
     mResults->CommitResults();
+    mUncommittedFrames = 0;
 
     AdvanceToActiveEnableEdge();
 
@@ -75,6 +251,7 @@ void SpiAnalyzer::AdvanceToActiveEnableEdgeWithCorrectClockPolarity()
             break;
         }
     }
+    mAssertSample = mCurrentSample;
 }
 
 void SpiAnalyzer::Setup()
@@ -113,22 +290,80 @@ void SpiAnalyzer::Setup()
 
     mClock = GetAnalyzerChannelData(mSettings->mClockChannel);
 
-    if (mSettings->mEnableChannel != UNDEFINED_CHANNEL) {
-        mEnable = GetAnalyzerChannelData(mSettings->mEnableChannel);
-    } else {
-        mEnable = NULL;
+    for (U32 i = 0; i < SPI_MAX_SLAVES; i++) {
+        Channel enable_channel = mSettings->GetEnableChannel(i);
+        if (enable_channel != UNDEFINED_CHANNEL) {
+            mEnables[i] = GetAnalyzerChannelData(enable_channel);
+        } else {
+            mEnables[i] = NULL;
+        }
+    }
+    mEnable = mEnables[0];
+    mMultiSlave = mSettings->IsMultiSlave();
+    mSlave = 0;
+
+    mClockIdleTimeoutSamples = 0;
+    if ((mEnable == NULL) && (mSettings->mClockIdleTimeout != 0)) {
+        mClockIdleTimeoutSamples = U64(mSettings->mClockIdleTimeout) * GetSampleRate() / 1000000;
+        if (mClockIdleTimeoutSamples == 0) {
+            mClockIdleTimeoutSamples = 1;
+        }
+    }
+
+    //dual, quad and octal modes: IO0 is MOSI, IO1 is MISO
+    mIo[0] = mMosi;
+    mIo[1] = mMiso;
+    mIo[2] = (mSettings->mIo2Channel != UNDEFINED_CHANNEL) ? GetAnalyzerChannelData(mSettings->mIo2Channel) : NULL;
+    mIo[3] = (mSettings->mIo3Channel != UNDEFINED_CHANNEL) ? GetAnalyzerChannelData(mSettings->mIo3Channel) : NULL;
+    for (U32 i = 4; i < SPI_MAX_LANES; i++) {
+        Channel io_channel = mSettings->mOctalIoChannels[i - 4];
+        mIo[i] = (io_channel != UNDEFINED_CHANNEL) ? GetAnalyzerChannelData(io_channel) : NULL;
+    }
+    mDqs = (mSettings->mDqsChannel != UNDEFINED_CHANNEL) ? GetAnalyzerChannelData(mSettings->mDqsChannel) : NULL;
+    mDtr = LANE_WIDTHS[mSettings->mLaneMode].mDtr;
+    mDc = (mSettings->mDcChannel != UNDEFINED_CHANNEL) ? GetAnalyzerChannelData(mSettings->mDcChannel) : NULL;
+
+    mIndependentLines = 0;
+    if (mSettings->mIndependentLines == true) {
+        for (U32 i = 0; i < SPI_MAX_LANES; i++) {
+            if (mIo[i] != NULL) {
+                mIndependentLines |= 1 << i;
+            }
+        }
+    }
+
+    mDetecting = mSettings->mAutoDetect;
+    SelectWordReader();
+}
+
+void SpiAnalyzer::SelectWordReader()
+{
+    //the dual/quad/octal and SPI NOR phases change the word length as they go, so those always take the general reader.
+    //so does collapsing repeated transactions, which compares every word with the last transaction, detecting the clock mode,
+    //and decoding independent data lines.
+    mWordReader = &SpiAnalyzer::GetWord;
+    if ((mSettings->mLaneMode == SpiAnalyzerEnums::SingleLane) && (mSettings->mNorCommands == false) && (mSettings->mCollapseRepeats == false) && (mDetecting == false) &&
+        (mIndependentLines == 0)) {
+        if (mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge) {
+            mWordReader = SelectWordReaderForOrder<AnalyzerEnums::LeadingEdge>();
+        } else {
+            mWordReader = SelectWordReaderForOrder<AnalyzerEnums::TrailingEdge>();
+        }
     }
 }
 
 void SpiAnalyzer::AdvanceToActiveEnableEdge()
 {
-    if (mEnable != NULL) {
+    if (mMultiSlave == true) {
+        AdvanceToNextSlaveAssertion(false);
+    } else if (mEnable != NULL) {
         if (mEnable->GetBitState() != mSettings->mEnableActiveState) {
             mEnable->AdvanceToNextEdge();
         } else {
             mEnable->AdvanceToNextEdge();
             mEnable->AdvanceToNextEdge();
         }
+        mEnableDeassertKnown = false;
         mCurrentSample = mEnable->GetSampleNumber();
         mClock->AdvanceToAbsPosition(mCurrentSample);
     } else {
@@ -136,12 +371,89 @@ void SpiAnalyzer::AdvanceToActiveEnableEdge()
     }
 }
 
+//several slaves: make the enable line that asserts first after mCurrentSample the current one, and move to its assertion.
+//a line that is already asserted only counts when starting out; otherwise it overlaps the last transaction, and is skipped.
+void SpiAnalyzer::AdvanceToNextSlaveAssertion(bool include_asserted)
+{
+    for (; ;) {
+        U32 slave = SPI_MAX_SLAVES;
+        U64 assert_sample = 0;
+
+        for (U32 i = 0; i < SPI_MAX_SLAVES; i++) {
+            AnalyzerChannelData *enable = mEnables[i];
+            if (enable == NULL) {
+                continue;
+            }
+
+            if (enable->GetSampleNumber() < mCurrentSample) {
+                enable->AdvanceToAbsPosition(mCurrentSample);
+            }
+
+            //only look at edges already captured; a line that stays idle mustn't hold up the others
+            U64 sample;
+            bool asserted = (enable->GetBitState() == mSettings->mEnableActiveState);
+            if ((asserted == true) && (include_asserted == true)) {
+                sample = enable->GetSampleNumber();
+            } else {
+                if (asserted == true) {
+                    if (enable->DoMoreTransitionsExistInCurrentData() == false) {
+                        continue;
+                    }
+                    enable->AdvanceToNextEdge();
+                }
+                if (enable->DoMoreTransitionsExistInCurrentData() == false) {
+                    continue;
+                }
+                sample = enable->GetSampleOfNextEdge();
+            }
+
+            if ((slave == SPI_MAX_SLAVES) || (sample < assert_sample)) {
+                slave = i;
+                assert_sample = sample;
+            }
+        }
+
+        if (slave != SPI_MAX_SLAVES) {
+            mSlave = slave;
+            mEnable = mEnables[slave];
+            if (mEnable->GetSampleNumber() < assert_sample) {
+                mEnable->AdvanceToAbsPosition(assert_sample);
+            }
+            mEnableDeassertKnown = false;
+            mCurrentSample = assert_sample;
+            mClock->AdvanceToAbsPosition(mCurrentSample);
+            return;
+        }
+
+        //no enable edge has been captured yet. wait for the next clock edge, and skip it if no enable line moved before it.
+        U64 clock_edge = mClock->GetSampleOfNextEdge();
+        bool enable_moved = false;
+        for (U32 i = 0; i < SPI_MAX_SLAVES; i++) {
+            if ((mEnables[i] != NULL) && (mEnables[i]->WouldAdvancingToAbsPositionCauseTransition(clock_edge) == true)) {
+                enable_moved = true;
+            }
+        }
+
+        if (enable_moved == false) {
+            mClock->AdvanceToNextEdge();
+            mCurrentSample = mClock->GetSampleNumber();
+        }
+        CheckIfThreadShouldExit();
+    }
+}
+
 bool SpiAnalyzer::IsInitialClockPolarityCorrect()
 {
+    if ((mDetecting == true) && (mDetectPartialAssertion == false)) {
+        mDetectIdleLevels[(mClock->GetBitState() == BIT_HIGH) ? 1 : 0]++;
+    }
+
     if (mClock->GetBitState() == mSettings->mClockInactiveState) {
         return true;
     }
 
+    AddRepeatFrame();   //the error frame comes after the run of repeats
+
     if (mSettings->mShowMarker) {
         mResults->AddMarker(mCurrentSample, AnalyzerResults::ErrorSquare, mSettings->mClockChannel);
     }
@@ -149,6 +461,11 @@ bool SpiAnalyzer::IsInitialClockPolarityCorrect()
     if (mEnable != NULL) {
         Frame error_frame;
         error_frame.mStartingSampleInclusive = mCurrentSample;
+        error_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiWordFrame, mSlave);
+
+        if (mDetecting == true) {
+            DetectSkippedAssertion();
+        }
 
         mEnable->AdvanceToNextEdge();
         mCurrentSample = mEnable->GetSampleNumber();
@@ -160,7 +477,13 @@ bool SpiAnalyzer::IsInitialClockPolarityCorrect()
         ReportProgress(error_frame.mEndingSampleInclusive);
 
         //move to the next active-going enable edge
+        if (mMultiSlave == true) {
+            AdvanceToNextSlaveAssertion(false);
+            return false;
+        }
+
         mEnable->AdvanceToNextEdge();
+        mEnableDeassertKnown = false;
         mCurrentSample = mEnable->GetSampleNumber();
         mClock->AdvanceToAbsPosition(mCurrentSample);
 
@@ -175,25 +498,85 @@ bool SpiAnalyzer::IsInitialClockPolarityCorrect()
 bool SpiAnalyzer::WouldAdvancingTheClockToggleEnable()
 {
     if (mEnable == NULL) {
-        return false;
+        //no enable line: a clock that has been idle too long ends the transaction instead, so one glitch can't misalign the rest of the capture.
+        if ((mClockIdleTimeoutSamples == 0) || (mClock->GetSampleNumber() == mClockIdleSample)) {
+            return false;
+        }
+
+        if ((mClock->GetSampleOfNextEdge() - mClock->GetSampleNumber()) <= mClockIdleTimeoutSamples) {
+            return false;
+        }
+
+        mClockIdleSample = mClock->GetSampleNumber();   //a gap only ends one transaction
+        return true;
     }
 
     U64 next_edge = mClock->GetSampleOfNextEdge();
-    bool enable_will_toggle = mEnable->WouldAdvancingToAbsPositionCauseTransition(next_edge);
 
-    if (enable_will_toggle == false) {
+    //the enable line only moves between assertions, so its next edge is the end of the current one.
+    //fetch it once, and check every clock edge of the assertion against it.
+    if (mEnableDeassertKnown == false) {
+        if (mEnable->DoMoreTransitionsExistInCurrentData() == false) {
+            //the deassert edge hasn't been captured yet; GetSampleOfNextEdge would wait for it, so probe instead.
+            return mEnable->WouldAdvancingToAbsPositionCauseTransition(next_edge);
+        }
+
+        mEnableDeassertSample = mEnable->GetSampleOfNextEdge();
+        mEnableDeassertKnown = true;
+    }
+
+    if (next_edge < mEnableDeassertSample) {
         return false;
     } else {
         return true;
     }
 }
 
+//The level of IO line 'line' (MOSI is IO0, MISO IO1) at 'sample'. The levels are kept packed in mLaneLevels, and a line
+//is only read again once the sample reaches its next transition, so a line that holds still (MISO idling during writes)
+//costs a compare per clock edge instead of a channel access.
+inline BitState SpiAnalyzer::SampleLine(U32 line, U64 sample)
+{
+    if (sample >= mLaneNextEdge[line]) {
+        AnalyzerChannelData *io = mIo[line];
+        io->AdvanceToAbsPosition(sample);
+        if (io->GetBitState() == BIT_HIGH) {
+            mLaneLevels |= 1 << line;
+        } else {
+            mLaneLevels &= ~(1 << line);
+        }
+
+        if (io->DoMoreTransitionsExistInCurrentData() == true) {
+            mLaneNextEdge[line] = io->GetSampleOfNextEdge();
+        } else {
+            mLaneNextEdge[line] = sample + 1;   //not captured yet; read the line again next time
+        }
+    }
+
+    return (((mLaneLevels >> line) & 1) != 0) ? BIT_HIGH : BIT_LOW;
+}
+
 void SpiAnalyzer::GetWord()
 {
     //we're assuming we come into this function with the clock in the idle state;
 
     U32 bits_per_transfer = mSettings->mBitsPerTransfer;
 
+    //dual/quad/octal modes and SPI NOR decoding: the word is the current phase, read lanes bits per clock edge.
+    bool phases = (mSettings->mLaneMode != SpiAnalyzerEnums::SingleLane) || (mSettings->mNorCommands == true);
+    U32 lanes = 0;
+    U64 lanes_word = 0;
+    bool dtr = false;
+    if (phases == true) {
+        bits_per_transfer = GetPhaseClocks(lanes);
+        dtr = (mDtr == true) && (lanes != 0);
+    }
+
+    //octal DTR phases are sampled on both edges
+    bool sample_leading_edge = (dtr == true) || (mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge);
+    bool sample_trailing_edge = (dtr == true) || (mSettings->mDataValidEdge == AnalyzerEnums::TrailingEdge);
+    U64 previous_edge = mClock->GetSampleNumber();
+
     DataBuilder mosi_result;
     U64 mosi_word = 0;
     mosi_result.Reset(&mosi_word, mSettings->mShiftOrder, bits_per_transfer);
@@ -202,8 +585,17 @@ void SpiAnalyzer::GetWord()
     U64 miso_word = 0;
     miso_result.Reset(&miso_word, mSettings->mShiftOrder, bits_per_transfer);
 
+    if (mIndependentLines != 0) {
+        for (U32 i = 0; i < SPI_MAX_LANES; i++) {
+            mLineWords[i] = 0;
+            mLineResults[i].Reset(&mLineWords[i], mSettings->mShiftOrder, bits_per_transfer);
+        }
+    }
+
     U64 first_sample = 0;
     bool need_reset = false;
+    //a frame per transaction gets one marker per word, on its first bit, rather than one per bit
+    bool marker_per_bit = (mSettings->mFrameGranularity == SpiAnalyzerEnums::FramePerWord);
 
     mArrowLocations.clear();
     ReportProgress(mClock->GetSampleNumber());
@@ -217,27 +609,37 @@ void SpiAnalyzer::GetWord()
             return;
         }
 
+        previous_edge = mClock->GetSampleNumber();
         mClock->AdvanceToNextEdge();
         if (i == 0) {
             first_sample = mClock->GetSampleNumber();
         }
+        if (mDetecting == true) {
+            AddDetectEdge(previous_edge, mClock->GetSampleNumber(), true);
+        }
 
-        if (mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge) {
+        if (sample_leading_edge == true) {
             mCurrentSample = mClock->GetSampleNumber();
-            if (mMosi != NULL) {
-                mMosi->AdvanceToAbsPosition(mCurrentSample);
-                mosi_result.AddBit(mMosi->GetBitState());
+            if (lanes != 0) {
+                lanes_word = (lanes_word << lanes) | SampleLanes(lanes, (dtr == true) ? GetLaneSample(previous_edge) : mCurrentSample);
+            } else if (mIndependentLines != 0) {
+                SampleIndependentLines(mCurrentSample);
+            } else {
+                if (mMosi != NULL) {
+                    mosi_result.AddBit(SampleLine(0, mCurrentSample));
+                }
+                if (mMiso != NULL) {
+                    miso_result.AddBit(SampleLine(1, mCurrentSample));
+                }
             }
-            if (mMiso != NULL) {
-                mMiso->AdvanceToAbsPosition(mCurrentSample);
-                miso_result.AddBit(mMiso->GetBitState());
+            if ((mSettings->mShowMarker) && ((marker_per_bit == true) || (mArrowLocations.empty() == true))) {
+                mArrowLocations.push_back(mCurrentSample);
             }
-            mArrowLocations.push_back(mCurrentSample);
         }
 
         // ok, the trailing edge is messy -- but only on the very last bit.
         // If the trialing edge isn't doesn't represent valid data, we want to allow the enable line to rise before the clock trialing edge -- and still report the frame
-        if ((i == (bits_per_transfer - 1)) && (mSettings->mDataValidEdge != AnalyzerEnums::TrailingEdge)) {
+        if ((i == (bits_per_transfer - 1)) && (sample_trailing_edge == false)) {
             //if this is the last bit, and the trailing edge doesn't represent valid data
             if (WouldAdvancingTheClockToggleEnable() == true) {
                 //moving to the trailing edge would cause the clock to revert to inactive.  jump out, record the frame, and them move to the next active enable edge
@@ -246,7 +648,11 @@ void SpiAnalyzer::GetWord()
             }
 
             //enable isn't going to go inactive, go ahead and advance the clock as usual.  Then we're done, jump out and record the frame.
+            previous_edge = mClock->GetSampleNumber();
             mClock->AdvanceToNextEdge();
+            if (mDetecting == true) {
+                AddDetectEdge(previous_edge, mClock->GetSampleNumber(), false);
+            }
             break;
         }
 
@@ -256,49 +662,842 @@ void SpiAnalyzer::GetWord()
             return;
         }
 
+        previous_edge = mClock->GetSampleNumber();
         mClock->AdvanceToNextEdge();
+        if (mDetecting == true) {
+            AddDetectEdge(previous_edge, mClock->GetSampleNumber(), false);
+        }
 
-        if (mSettings->mDataValidEdge == AnalyzerEnums::TrailingEdge) {
+        if (sample_trailing_edge == true) {
             mCurrentSample = mClock->GetSampleNumber();
-            if (mMosi != NULL) {
-                mMosi->AdvanceToAbsPosition(mCurrentSample);
-                mosi_result.AddBit(mMosi->GetBitState());
+            if (lanes != 0) {
+                lanes_word = (lanes_word << lanes) | SampleLanes(lanes, (dtr == true) ? GetLaneSample(previous_edge) : mCurrentSample);
+            } else if (mIndependentLines != 0) {
+                SampleIndependentLines(mCurrentSample);
+            } else {
+                if (mMosi != NULL) {
+                    mosi_result.AddBit(SampleLine(0, mCurrentSample));
+                }
+                if (mMiso != NULL) {
+                    miso_result.AddBit(SampleLine(1, mCurrentSample));
+                }
             }
-            if (mMiso != NULL) {
-                mMiso->AdvanceToAbsPosition(mCurrentSample);
-                miso_result.AddBit(mMiso->GetBitState());
+            if ((mSettings->mShowMarker) && ((marker_per_bit == true) || (mArrowLocations.empty() == true))) {
+                mArrowLocations.push_back(mCurrentSample);
             }
-            mArrowLocations.push_back(mCurrentSample);
         }
 
     }
 
+    //a word that differs from the last transaction lets its held frames out before the word's own markers and frames are added
+    if (mSettings->mCollapseRepeats == true) {
+        if (dtr == true) {  //compared and kept as bytes, like the payload buffers keep them
+            AddRepeatWord(first_sample, first_sample, lanes_word >> 8, lanes_word >> 8);
+            AddRepeatWord(first_sample, mClock->GetSampleNumber(), lanes_word & 0xFF, lanes_word & 0xFF);
+        } else if (lanes != 0) {
+            AddRepeatWord(first_sample, mClock->GetSampleNumber(), lanes_word, lanes_word);
+        } else {
+            AddRepeatWord(first_sample, mClock->GetSampleNumber(), mosi_word, miso_word);
+        }
+    }
+
     //save the resuls:
+    AddArrowMarkers();
+
+    //every clock contributes two edges, but the trailing edge of the last one is missing if enable went inactive first
+    AddWordTiming(first_sample, mClock->GetSampleNumber(), 2 * bits_per_transfer - ((need_reset == true) ? 2 : 1));
+
+    if ((dtr == true) && (mPhase == DataPhase)) {   //two bytes per clock, one frame each
+        U64 middle_sample = (first_sample + mClock->GetSampleNumber()) / 2;
+        AddDataWord(first_sample, middle_sample, lanes_word >> 8, lanes_word >> 8);
+        AddDataWord(middle_sample + 1, mClock->GetSampleNumber(), lanes_word & 0xFF, lanes_word & 0xFF);
+    } else if (lanes != 0) {
+        AddPhaseWord(first_sample, mClock->GetSampleNumber(), lanes_word, lanes_word);    //the word is on all the lines
+    } else if (phases == true) {
+        AddPhaseWord(first_sample, mClock->GetSampleNumber(), mosi_word, miso_word);
+    } else if (mIndependentLines != 0) {
+        AddIndependentWord(first_sample, mClock->GetSampleNumber());
+    } else {
+        AddWord(first_sample, mClock->GetSampleNumber(), mosi_word, miso_word);
+    }
+
+    if (need_reset == true) {
+        AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
+    }
+}
+
+//GetWord for standard SPI words, with the settings as template parameters so the bit loop only branches on the enable checks
+template <AnalyzerEnums::Edge DATA_VALID_EDGE, AnalyzerEnums::ShiftOrder SHIFT_ORDER, U32 BITS, SpiAnalyzer::SpiWordLines LINES>
+void SpiAnalyzer::GetFixedWord()
+{
+    //we're assuming we come into this function with the clock in the idle state;
+
+    U64 mosi_word = 0;
+    U64 miso_word = 0;
+    U64 first_sample = 0;
+    bool need_reset = false;
+    bool show_marker = mSettings->mShowMarker;
+    bool marker_per_bit = (mSettings->mFrameGranularity == SpiAnalyzerEnums::FramePerWord);   //as in GetWord
+
+    mArrowLocations.clear();
+    ReportProgress(mClock->GetSampleNumber());
+
+    for (U32 i = 0; i < BITS; i++) {
+        if (WouldAdvancingTheClockToggleEnable() == true) {
+            AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
+            return;
+        }
+
+        mClock->AdvanceToNextEdge();
+        if (i == 0) {
+            first_sample = mClock->GetSampleNumber();
+        }
+
+        if (DATA_VALID_EDGE == AnalyzerEnums::LeadingEdge) {
+            mCurrentSample = mClock->GetSampleNumber();
+            if (LINES != MisoLine) {
+                AddBit<SHIFT_ORDER>(mosi_word, i, SampleLine(0, mCurrentSample));
+            }
+            if (LINES != MosiLine) {
+                AddBit<SHIFT_ORDER>(miso_word, i, SampleLine(1, mCurrentSample));
+            }
+            if ((show_marker) && ((marker_per_bit == true) || (mArrowLocations.empty() == true))) {
+                mArrowLocations.push_back(mCurrentSample);
+            }
+
+            //the trailing edge of the last bit may fall outside the enable assertion
+            if (i == (BITS - 1)) {
+                if (WouldAdvancingTheClockToggleEnable() == true) {
+                    need_reset = true;
+                    break;
+                }
+
+                mClock->AdvanceToNextEdge();
+                break;
+            }
+        }
+
+        if (WouldAdvancingTheClockToggleEnable() == true) {
+            AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
+            return;
+        }
+
+        mClock->AdvanceToNextEdge();
+
+        if (DATA_VALID_EDGE == AnalyzerEnums::TrailingEdge) {
+            mCurrentSample = mClock->GetSampleNumber();
+            if (LINES != MisoLine) {
+                AddBit<SHIFT_ORDER>(mosi_word, i, SampleLine(0, mCurrentSample));
+            }
+            if (LINES != MosiLine) {
+                AddBit<SHIFT_ORDER>(miso_word, i, SampleLine(1, mCurrentSample));
+            }
+            if ((show_marker) && ((marker_per_bit == true) || (mArrowLocations.empty() == true))) {
+                mArrowLocations.push_back(mCurrentSample);
+            }
+        }
+    }
+
     U32 count = mArrowLocations.size();
     for (U32 i = 0; i < count; i++) {
-        if (mSettings->mShowMarker) {
-            mResults->AddMarker(mArrowLocations[i], mArrowMarker, mSettings->mClockChannel);
+        mResults->AddMarker(mArrowLocations[i], mArrowMarker, mSettings->mClockChannel);
+    }
+
+    AddWordTiming(first_sample, mClock->GetSampleNumber(), 2 * BITS - ((need_reset == true) ? 2 : 1));
+    AddWord(first_sample, mClock->GetSampleNumber(), mosi_word, miso_word);
+
+    if (need_reset == true) {
+        AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
+    }
+}
+
+template <AnalyzerEnums::Edge DATA_VALID_EDGE, AnalyzerEnums::ShiftOrder SHIFT_ORDER, U32 BITS>
+SpiAnalyzer::WordReader SpiAnalyzer::SelectWordReaderForLines()
+{
+    if (mMosi == NULL) {
+        return &SpiAnalyzer::GetFixedWord<DATA_VALID_EDGE, SHIFT_ORDER, BITS, MisoLine>;
+    }
+    if (mMiso == NULL) {
+        return &SpiAnalyzer::GetFixedWord<DATA_VALID_EDGE, SHIFT_ORDER, BITS, MosiLine>;
+    }
+
+    return &SpiAnalyzer::GetFixedWord<DATA_VALID_EDGE, SHIFT_ORDER, BITS, MosiAndMisoLines>;
+}
+
+//other word lengths take the general reader
+template <AnalyzerEnums::Edge DATA_VALID_EDGE, AnalyzerEnums::ShiftOrder SHIFT_ORDER>
+SpiAnalyzer::WordReader SpiAnalyzer::SelectWordReaderForWidth()
+{
+    switch (mSettings->mBitsPerTransfer) {
+    case 8:
+        return SelectWordReaderForLines<DATA_VALID_EDGE, SHIFT_ORDER, 8>();
+    case 16:
+        return SelectWordReaderForLines<DATA_VALID_EDGE, SHIFT_ORDER, 16>();
+    case 32:
+        return SelectWordReaderForLines<DATA_VALID_EDGE, SHIFT_ORDER, 32>();
+    default:
+        return &SpiAnalyzer::GetWord;
+    }
+}
+
+template <AnalyzerEnums::Edge DATA_VALID_EDGE>
+SpiAnalyzer::WordReader SpiAnalyzer::SelectWordReaderForOrder()
+{
+    if (mSettings->mShiftOrder == AnalyzerEnums::MsbFirst) {
+        return SelectWordReaderForWidth<DATA_VALID_EDGE, AnalyzerEnums::MsbFirst>();
+    }
+
+    return SelectWordReaderForWidth<DATA_VALID_EDGE, AnalyzerEnums::LsbFirst>();
+}
+
+//clocks in the current phase of the transaction, and the lanes each clock edge carries.
+//phases on a single line report 0 lanes, and are read like standard SPI words so the data bytes keep both their MOSI and MISO side.
+//octal DTR moves two bytes per clock: the command is the opcode and its extension, and data words are two bytes.
+U32 SpiAnalyzer::GetPhaseClocks(U32 &lanes)
+{
+    U32 bits;
+
+    switch (mPhase) {
+    case CommandPhase:
+        lanes = mCommandLanes;
+        bits = (mDtr == true) ? 16 : 8;
+        break;
+    case AddressPhase:
+        lanes = mAddressLanes;
+        bits = 8 * mPhaseAddressBytes;
+        break;
+    case DummyPhase:
+        lanes = 1;
+        bits = mPhaseDummyClocks;
+        break;
+    default:
+        lanes = mDataLanes;
+        bits = (mDtr == true) ? 16 : 8;
+        break;
+    }
+
+    U32 clocks = bits / lanes;
+    if (lanes == 1) {
+        lanes = 0;
+    } else if (mDtr == true) {
+        clocks /= 2;
+    }
+
+    return clocks;
+}
+
+//IO0 is the least significant bit
+U64 SpiAnalyzer::SampleLanes(U32 lanes, U64 sample)
+{
+    if (sample < mLaneSample) {     //a DQS sample can be later than the clock edge after it
+        sample = mLaneSample;
+    }
+    mLaneSample = sample;
+
+    for (U32 i = 0; i < lanes; i++) {
+        SampleLine(i, sample);
+    }
+
+    return mLaneLevels & ((1 << lanes) - 1);
+}
+
+//octal DTR: where to sample the IO lines for the clock edge at mCurrentSample. In data phases with DQS, data driven by the flash
+//changes with the DQS edge that follows the clock edge, so sample a quarter clock after it; otherwise, at the clock edge.
+U64 SpiAnalyzer::GetLaneSample(U64 previous_edge)
+{
+    if ((mDqs == NULL) || (mPhase != DataPhase)) {
+        return mCurrentSample;
+    }
+
+    //the shorter half period around this edge, in case the clock stops before or after it
+    U64 half_period = mCurrentSample - previous_edge;
+    if (mClock->DoMoreTransitionsExistInCurrentData() == true) {
+        U64 next_half_period = mClock->GetSampleOfNextEdge() - mCurrentSample;
+        if (next_half_period < half_period) {
+            half_period = next_half_period;
         }
     }
 
+    //no DQS edge within the half period: the host is driving the data
+    mDqs->AdvanceToAbsPosition(mCurrentSample - 1);
+    if ((half_period < 2) || (mDqs->WouldAdvancingToAbsPositionCauseTransition(mCurrentSample + half_period - 1) == false)) {
+        return mCurrentSample;
+    }
+
+    return mDqs->GetSampleOfNextEdge() + half_period / 2;
+}
+
+void SpiAnalyzer::AddPhaseWord(U64 starting_sample, U64 ending_sample, U64 mosi_word, U64 miso_word)
+{
+    if (mPhase == DataPhase) {
+        AddDataWord(starting_sample, ending_sample, mosi_word, miso_word);
+        return;
+    }
+
     Frame result_frame;
-    result_frame.mStartingSampleInclusive = first_sample;
-    result_frame.mEndingSampleInclusive = mClock->GetSampleNumber();
+    result_frame.mStartingSampleInclusive = starting_sample;
+    result_frame.mEndingSampleInclusive = ending_sample;
     result_frame.mData1 = mosi_word;
-    result_frame.mData2 = miso_word;
+    result_frame.mData2 = 0;
     result_frame.mFlags = 0;
-    mResults->AddFrame(result_frame);
 
+    if (mPhase == CommandPhase) {
+        result_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiCommandFrame, mSlave);
+        result_frame.mData2 = (mDtr == true) ? 2 : 1;
+    } else if (mPhase == AddressPhase) {
+        result_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiAddressFrame, mSlave);
+        result_frame.mData2 = mPhaseAddressBytes;
+        mNorAddress = mosi_word;
+        mFlashImages[mSlave].AddErase(mNorCommand, mNorAddress);
+    } else {
+        result_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiDummyFrame, mSlave);
+        result_frame.mData1 = 0;
+        result_frame.mData2 = mPhaseDummyClocks;
+    }
+
+    AddResultFrame(result_frame);
+
+    if ((mPhase == CommandPhase) && (mSettings->mNorCommands == true)) {
+        SelectNorCommand(U8((mDtr == true) ? (mosi_word >> 8) : mosi_word));   //the opcode comes before its extension
+    }
+
+    //move on to the next phase the transaction has
+    if ((mPhase == CommandPhase) && (mPhaseAddressBytes != 0)) {
+        mPhase = AddressPhase;
+    } else if ((mPhase != DummyPhase) && (mPhaseDummyClocks != 0)) {
+        mPhase = DummyPhase;
+    } else {
+        mPhase = DataPhase;
+    }
+}
+
+void SpiAnalyzer::AddDataWord(U64 starting_sample, U64 ending_sample, U64 mosi_word, U64 miso_word)
+{
+    if (mNorCommand == NULL) {
+        AddWord(starting_sample, ending_sample, mosi_word, miso_word);
+        return;
+    }
+
+    //programs go into the flash image, reads are checked against it
+    U64 data = (mNorCommand->mDataFromFlash == true) ? miso_word : mosi_word;
+    U8 expected;
+    bool matches = mFlashImages[mSlave].AddData(mNorCommand, mNorAddress, mDataIndex, U8(data), expected);
+
+    //the transaction frame holds the data bytes, and is marked as a whole if one of them doesn't match
+    if (mSettings->mFrameGranularity == SpiAnalyzerEnums::FramePerTransaction) {
+        if (matches == false) {
+            mTransactionNorMismatch = true;
+        }
+        AddWord(starting_sample, ending_sample, mosi_word, miso_word);
+        mDataIndex++;
+        return;
+    }
+
+    //keep the side of the byte the opcode says is driven, and where in the data phase it is
+    Frame result_frame;
+    result_frame.mStartingSampleInclusive = starting_sample;
+    result_frame.mEndingSampleInclusive = ending_sample;
+    result_frame.mData1 = data;
+    result_frame.mData2 = (U64(mNorCommand->mOpcode) << 32) | mDataIndex;
+    result_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiDataFrame, mSlave);
+    result_frame.mFlags = 0;
+    if (matches == false) {
+        result_frame.mData2 |= U64(expected) << 40;
+        result_frame.mFlags = SPI_NOR_MISMATCH_FLAG | DISPLAY_AS_WARNING_FLAG;
+    }
+    AddResultFrame(result_frame);
+    mDataIndex++;
+}
+
+//back to the command phase, with the shape the settings give a transaction
+void SpiAnalyzer::ResetPhases()
+{
+    const SpiLaneWidths &widths = LANE_WIDTHS[mSettings->mLaneMode];
+
+    mPhase = CommandPhase;
+    mCommandLanes = widths.mCommand;
+    mAddressLanes = widths.mAddress;
+    mDataLanes = widths.mData;
+    mPhaseAddressBytes = mSettings->mAddressBytes;
+    mPhaseDummyClocks = mSettings->mDummyCycles;
+    mNorCommand = NULL;
+    mNorAddress = 0;
+    mDataIndex = 0;
+}
+
+//SPI NOR decoding: the opcode decides what follows it
+void SpiAnalyzer::SelectNorCommand(U8 opcode)
+{
+    mNorCommand = GetSpiNorCommand(opcode);
+
+    if (mNorCommand == NULL) {  //unknown opcode, take the rest of the transaction as plain words
+        mPhaseAddressBytes = 0;
+        mPhaseDummyClocks = 0;
+        mDataLanes = mCommandLanes;
+        return;
+    }
+
+    if (mNorCommand->mAddressBytes == SPI_NOR_DEFAULT_ADDRESS) {
+        mPhaseAddressBytes = (mSettings->mAddressBytes == 4) ? 4 : 3;
+    } else {
+        mPhaseAddressBytes = mNorCommand->mAddressBytes;
+    }
+    mPhaseDummyClocks = mNorCommand->mDummyClocks;
+
+    if (mPhaseAddressBytes == 0) {  //chip erases have no address phase
+        mFlashImages[mSlave].AddErase(mNorCommand, 0);
+    }
+
+    //octal DTR addresses are always 4 bytes, two clocks
+    if ((mDtr == true) && (mPhaseAddressBytes != 0)) {
+        mPhaseAddressBytes = 4;
+    }
+
+    //in QPI and octal 8-8-8 modes every phase is on all the lines already
+    if (mCommandLanes == 1) {
+        mAddressLanes = GetUsableLanes(mNorCommand->mAddressLanes);
+        mDataLanes = GetUsableLanes(mNorCommand->mDataLanes);
+    }
+}
+
+//fall back to a single line when the IO lines a command needs aren't set up
+U32 SpiAnalyzer::GetUsableLanes(U32 lanes)
+{
+    for (U32 i = 0; i < lanes; i++) {
+        if (mIo[i] == NULL) {
+            return 1;
+        }
+    }
+
+    return lanes;
+}
+
+void SpiAnalyzer::AddWord(U64 starting_sample, U64 ending_sample, U64 mosi_word, U64 miso_word)
+{
+    if (mSettings->mSdCard == true) {
+        mSdCards[mSlave].AddByte(starting_sample, ending_sample, U8(mosi_word), U8(miso_word), mDecodedFrames);
+        AddDecodedFrames();
+        return;
+    }
+
+    if (mSettings->mDisplay == true) {
+        //D/C is read at the last bit of the byte; 3-wire panels send it as the first of 9 bits instead
+        bool command;
+        if (mDc != NULL) {
+            mDc->AdvanceToAbsPosition(ending_sample);
+            command = (mDc->GetBitState() == BIT_LOW);
+        } else {
+            command = ((mosi_word & 0x100) == 0);
+        }
+
+        mDisplays[mSlave].AddByte(starting_sample, ending_sample, U8(mosi_word), U8(miso_word), command, mDecodedFrames);
+        AddDecodedFrames();
+        return;
+    }
+
+    if (mSettings->mFrameGranularity == SpiAnalyzerEnums::FramePerWord) {
+        Frame result_frame;
+        result_frame.mStartingSampleInclusive = starting_sample;
+        result_frame.mEndingSampleInclusive = ending_sample;
+        result_frame.mData1 = mosi_word;
+        result_frame.mData2 = miso_word;
+        result_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiWordFrame, mSlave);
+        result_frame.mFlags = 0;
+        AddResultFrame(result_frame);
+        return;
+    }
+
+    //the words go to the results' payload buffers; the frame is added once the enable line goes inactive.
+    if (mTransactionWords == 0) {
+        mTransactionFirstWord = mResults->GetPayloadWordCount();
+        mTransactionStartingSample = starting_sample;
+    }
+    mResults->AddPayloadWord(mosi_word, miso_word);
+    mTransactionWords++;
+    mTransactionEndingSample = ending_sample;
+
+    //without an enable line there is no end to the transaction, so cut it into pieces that can be shown as they are decoded.
+    const U64 max_words_without_enable = 4096;
+    if ((mEnable == NULL) && (mTransactionWords >= max_words_without_enable)) {
+        EndTransaction();
+    }
+}
+
+void SpiAnalyzer::EndTransaction()
+{
+    if (mTransactionWords == 0) {
+        return;
+    }
+
+    Frame result_frame;
+    result_frame.mStartingSampleInclusive = mTransactionStartingSample;
+    result_frame.mEndingSampleInclusive = mTransactionEndingSample;
+    result_frame.mData1 = mTransactionFirstWord;
+    result_frame.mData2 = mTransactionWords;
+    result_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiTransactionFrame, mSlave);
+    result_frame.mFlags = (mTransactionNorMismatch == true) ? (SPI_NOR_MISMATCH_FLAG | DISPLAY_AS_WARNING_FLAG) : 0;
+    AddResultFrame(result_frame);
+    mTransactionWords = 0;
+    mTransactionNorMismatch = false;
+}
+
+//timing statistics of one word: the gap from the previous word, or the enable setup time if it is the first of the transaction
+void SpiAnalyzer::AddWordTiming(U64 first_edge, U64 last_edge, U32 half_periods)
+{
+    if (mTimingWords != 0) {
+        AddTimingValue(mTiming[SpiWordGap], first_edge - mTimingLastEdge);
+    } else if (mEnable != NULL) {
+        AddTimingValue(mTiming[SpiEnableSetup], first_edge - mAssertSample);
+    }
+
+    mTimingWords++;
+    mTimingLastEdge = last_edge;
+    mTimingSpanSamples += last_edge - first_edge;
+    mTimingHalfPeriods += half_periods;
+
+    //without an enable line, hand the statistics over in pieces like the transaction frames
+    const U64 max_words_without_enable = 4096;
+    if ((mEnable == NULL) && (mTimingWords >= max_words_without_enable)) {
+        EndTransactionTiming();
+    }
+}
+
+//the clock period and enable hold time of the transaction that just ended, and the statistics so far to the results
+void SpiAnalyzer::EndTransactionTiming()
+{
+    if (mTimingWords == 0) {
+        return;
+    }
+
+    if (mTimingHalfPeriods != 0) {
+        AddTimingValue(mTiming[SpiClockPeriod], 2 * mTimingSpanSamples / mTimingHalfPeriods);
+    }
+
+    if (mEnable != NULL) {
+        U64 deassert_sample = (mEnableDeassertKnown == true) ? mEnableDeassertSample : mEnable->GetSampleOfNextEdge();
+        AddTimingValue(mTiming[SpiEnableHold], deassert_sample - mTimingLastEdge);
+    }
+
+    mResults->UpdateTimingStatistics(mTiming);
+
+    mTimingWords = 0;
+    mTimingSpanSamples = 0;
+    mTimingHalfPeriods = 0;
+}
+
+//with an enable line, frames are committed at the end of every assertion, and every 256 frames of a long one.
+//without one there may never be another deassert to flush them, so every frame is committed as it is added.
+//the capture may also end with the enable line still active: once the deassert or the clock edges run out, the same holds.
+void SpiAnalyzer::AddResultFrame(const Frame &frame)
+{
+    const U32 max_uncommitted_frames = 256;
+
+    if (mAssertionRepeating == true) {
+        mHeldFrames.push_back(frame);
+        return;
+    }
+
+    mResults->AddFrame(frame);
+    mUncommittedFrames++;
+
+    if ((mEnable == NULL) || (mUncommittedFrames >= max_uncommitted_frames) || (mEnable->DoMoreTransitionsExistInCurrentData() == false) ||
+        (mClock->DoMoreTransitionsExistInCurrentData() == false)) {
+        mResults->CommitResults();
+        mUncommittedFrames = 0;
+    }
+}
+
+//the frames the SD card or display decoder completed, tagged with the slave they belong to
+void SpiAnalyzer::AddDecodedFrames()
+{
+    for (U32 i = 0; i < mDecodedFrames.size(); i++) {
+        Frame &frame = mDecodedFrames[i];
+        frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(frame.mType, mSlave);
+        AddResultFrame(frame);
+    }
+    mDecodedFrames.clear();
+}
+
+//the markers of the last word, held back like its frames while the transaction repeats the last one
+void SpiAnalyzer::AddArrowMarkers()
+{
+    if (mAssertionRepeating == true) {
+        mHeldMarkers.insert(mHeldMarkers.end(), mArrowLocations.begin(), mArrowLocations.end());
+        return;
+    }
+
+    U32 count = mArrowLocations.size();
+    for (U32 i = 0; i < count; i++) {
+        mResults->AddMarker(mArrowLocations[i], mArrowMarker, mSettings->mClockChannel);
+    }
+}
+
+//collapsing repeated transactions: the words of the current assertion are compared with mRepeatWords as they come in.
+//while they match, the assertion's frames and markers are held back; the first word that differs lets them out.
+void SpiAnalyzer::AddRepeatWord(U64 starting_sample, U64 ending_sample, U64 mosi_word, U64 miso_word)
+{
+    const U64 max_repeat_words = 64;    //status polls and the like are a few words; longer transactions are always shown
+
+    U64 index = mAssertionWords.size();
+    if (index == 0) {
+        mAssertionStartingSample = starting_sample;
+        mAssertionFirstPayloadWord = mResults->GetPayloadWordCount();
+    }
+    mAssertionEndingSample = ending_sample;
+
+    if (index <= 2 * max_repeat_words) {    //one pair past the limit marks the assertion as too long
+        mAssertionWords.push_back(mosi_word);
+        mAssertionWords.push_back(miso_word);
+    }
+
+    if (mAssertionRepeating == true) {
+        if ((mSlave != mRepeatSlave) || (index >= mRepeatWords.size()) || (mRepeatWords[index] != mosi_word) || (mRepeatWords[index + 1] != miso_word)) {
+            ReleaseHeldFrames();
+        }
+    }
+
+    //the capture may end after this word, and the analyzer would wait for the next one with the frames still held:
+    //show the run so far, and this transaction in full.
+    if ((mAssertionRepeating == true) && (mClock->DoMoreTransitionsExistInCurrentData() == false)) {
+        ReleaseHeldFrames();
+    }
+}
+
+//the current assertion isn't a repeat: end the run of repeats before it, and add what it held back
+void SpiAnalyzer::ReleaseHeldFrames()
+{
+    mAssertionRepeating = false;
+    AddRepeatFrame();
+
+    for (U32 i = 0; i < mHeldFrames.size(); i++) {
+        AddResultFrame(mHeldFrames[i]);
+    }
+    for (U32 i = 0; i < mHeldMarkers.size(); i++) {
+        mResults->AddMarker(mHeldMarkers[i], mArrowMarker, mSettings->mClockChannel);
+    }
+    mHeldFrames.clear();
+    mHeldMarkers.clear();
+}
+
+//end of an enable assertion: a transaction that repeats the last one shown in full is dropped and counted; any other one ends
+//the run, and the next transactions are compared with it. Returns true if the transaction was dropped.
+bool SpiAnalyzer::EndRepeatAssertion()
+{
+    const U64 max_repeat_words = 64;
+
+    if ((mSettings->mCollapseRepeats == false) || (mAssertionWords.empty() == true)) {
+        return false;
+    }
+
+    bool repeat = (mAssertionRepeating == true) && (mAssertionWords.size() == mRepeatWords.size());
+    if (repeat == true) {
+        mHeldFrames.clear();
+        mHeldMarkers.clear();
+        mResults->RemovePayloadWords(mAssertionFirstPayloadWord);   //transaction frames: the words of the dropped frame
+
+        //the words of the repeat frame go to the payload buffers now, before the next transaction adds its own
+        if (mRepeatCount == 0) {
+            mRepeatFirstWord = mResults->GetPayloadWordCount();
+            for (U32 i = 0; i < mRepeatWords.size(); i += 2) {
+                mResults->AddPayloadWord(mRepeatWords[i], mRepeatWords[i + 1]);
+            }
+        }
+        mRepeatCount++;
+        mRepeatStartingSamples.push_back(mAssertionStartingSample);
+        mRepeatEndingSample = mAssertionEndingSample;
+    } else {
+        ReleaseHeldFrames();
+
+        if (mAssertionWords.size() <= 2 * max_repeat_words) {
+            mRepeatWords.swap(mAssertionWords);
+            mRepeatSlave = mSlave;
+        } else {
+            mRepeatWords.clear();
+        }
+    }
+
+    mAssertionWords.clear();
+    mAssertionRepeating = (mRepeatWords.empty() == false);
+    return repeat;
+}
+
+//one frame, in a packet of its own, for the run of repeats so far
+void SpiAnalyzer::AddRepeatFrame()
+{
+    if (mRepeatCount == 0) {
+        return;
+    }
+
+    Frame result_frame;
+    result_frame.mStartingSampleInclusive = mRepeatStartingSamples.front();
+    result_frame.mEndingSampleInclusive = mRepeatEndingSample;
+    result_frame.mData1 = mRepeatFirstWord;
+    result_frame.mData2 = (mRepeatWords.size() / 2) | (mRepeatCount << 32);
+    result_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiRepeatFrame, mRepeatSlave);
+    result_frame.mFlags = 0;
+
+    mResults->AddRepeatStartingSamples(mRepeatStartingSamples);
+    mResults->AddFrame(result_frame);
+    mResults->CommitPacketAndStartNewPacket();
     mResults->CommitResults();
+    mRepeatCount = 0;
+    mRepeatStartingSamples.clear();
+}
 
-    if (need_reset == true) {
-        AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
+//Detecting the clock mode and word size: the first assertions are decoded with the settings as they are, and checked against them.
+//A data line changes just after the edge that shifts it out, so the edge furthest from its transitions is the data valid one.
+void SpiAnalyzer::AddDetectEdge(U64 previous_edge, U64 edge, bool leading)
+{
+    if (leading == true) {
+        mDetectClocks++;
     }
+
+    AnalyzerChannelData *data = (mMosi != NULL) ? mMosi : mMiso;
+    if (data->GetSampleNumber() < previous_edge) {
+        data->AdvanceToAbsPosition(previous_edge);
+    }
+    if (data->WouldAdvancingToAbsPositionCauseTransition(edge) == false) {
+        return;
+    }
+
+    //a transition nearer the previous edge was shifted out by it, so data is valid on this kind of edge; nearer this edge, on the other
+    U64 transition = data->GetSampleOfNextEdge();
+    bool follows_previous_edge = ((transition - previous_edge) < (edge - transition));
+    mDetectValidEdges[(follows_previous_edge == leading) ? AnalyzerEnums::LeadingEdge : AnalyzerEnums::TrailingEdge]++;
+    data->AdvanceToAbsPosition(edge);
+}
+
+//an assertion the clock polarity check skips: go through its clock edges anyway, with the idle level the clock actually has
+void SpiAnalyzer::DetectSkippedAssertion()
+{
+    if (mEnable->DoMoreTransitionsExistInCurrentData() == false) {
+        return;
+    }
+
+    BitState idle_state = mClock->GetBitState();
+    U64 deassert_sample = mEnable->GetSampleOfNextEdge();
+    while ((mClock->DoMoreTransitionsExistInCurrentData() == true) && (mClock->GetSampleOfNextEdge() < deassert_sample)) {
+        bool leading = (mClock->GetBitState() == idle_state);
+        U64 previous_edge = mClock->GetSampleNumber();
+        mClock->AdvanceToNextEdge();
+        AddDetectEdge(previous_edge, mClock->GetSampleNumber(), leading);
+    }
+
+    EndDetectAssertion();
 }
 
+//the clocks of each assertion, for picking the word size once the first assertions have been seen
+void SpiAnalyzer::EndDetectAssertion()
+{
+    const U32 max_detect_assertions = 64;
+
+    if (mDetectPartialAssertion == true) {
+        mDetectPartialAssertion = false;
+        mDetectClocks = 0;
+        return;
+    }
+
+    if (mDetectClocks != 0) {
+        mDetectAssertionClocks.push_back(mDetectClocks);
+    }
+    mDetectClocks = 0;
+
+    mDetectAssertions++;
+    if (mDetectAssertions >= max_detect_assertions) {   //seen enough; the rest of the capture takes the fast readers again
+        mDetecting = false;
+        SelectWordReader();
+    }
+}
+
+//words of 'bits' fit the clocks of most assertions
+bool SpiAnalyzer::DetectWordsFit(U32 bits)
+{
+    U32 fit = 0;
+    for (U32 i = 0; i < mDetectAssertionClocks.size(); i++) {
+        if ((mDetectAssertionClocks[i] % bits) == 0) {
+            fit++;
+        }
+    }
+    return (2 * fit) > mDetectAssertionClocks.size();
+}
+
+//independent data lines: one bit of every line's word, at the same clock edge
+void SpiAnalyzer::SampleIndependentLines(U64 sample)
+{
+    for (U32 i = 0; i < SPI_MAX_LANES; i++) {
+        if ((mIndependentLines & (1 << i)) != 0) {
+            mLineResults[i].AddBit(SampleLine(i, sample));
+        }
+    }
+}
+
+//independent data lines: the words of the lines go to the payload buffers, two lines per payload word, and one frame points at them.
+//only the payload words up to the highest line used are stored.
+void SpiAnalyzer::AddIndependentWord(U64 starting_sample, U64 ending_sample)
+{
+    Frame result_frame;
+    result_frame.mStartingSampleInclusive = starting_sample;
+    result_frame.mEndingSampleInclusive = ending_sample;
+    result_frame.mData1 = mResults->GetPayloadWordCount();
+    result_frame.mData2 = mIndependentLines;
+    result_frame.mType = SPI_FRAME_TYPE_FOR_SLAVE(SpiLineWordsFrame, mSlave);
+    result_frame.mFlags = 0;
+
+    for (U32 i = 0; (mIndependentLines >> i) != 0; i += 2) {
+        mResults->AddPayloadWord(mLineWords[i], mLineWords[i + 1]);
+    }
+    AddResultFrame(result_frame);
+}
+
+//with mode and word size detection on, called once the capture has been decoded: if the first assertions didn't fit the settings,
+//change them to what the assertions showed, and decode again
 bool SpiAnalyzer::NeedsRerun()
 {
-    return false;
+    if ((mSettings->mAutoDetect == false) || (mDetectAssertions == 0)) {
+        return false;
+    }
+
+    bool rerun = false;
+
+    BitState idle_state = (mDetectIdleLevels[1] > mDetectIdleLevels[0]) ? BIT_HIGH : BIT_LOW;
+    if (idle_state != mSettings->mClockInactiveState) {
+        mSettings->mClockInactiveState = idle_state;
+        rerun = true;
+    }
+
+    //only change the edge on a clear majority; lines that rarely change say little
+    const U64 min_edge_votes = 16;
+    U64 leading_votes = mDetectValidEdges[AnalyzerEnums::LeadingEdge];
+    U64 trailing_votes = mDetectValidEdges[AnalyzerEnums::TrailingEdge];
+    if ((leading_votes + trailing_votes) >= min_edge_votes) {
+        if ((leading_votes > 2 * trailing_votes) && (mSettings->mDataValidEdge != AnalyzerEnums::LeadingEdge)) {
+            mSettings->mDataValidEdge = AnalyzerEnums::LeadingEdge;
+            rerun = true;
+        } else if ((trailing_votes > 2 * leading_votes) && (mSettings->mDataValidEdge != AnalyzerEnums::TrailingEdge)) {
+            mSettings->mDataValidEdge = AnalyzerEnums::TrailingEdge;
+            rerun = true;
+        }
+    }
+
+    //the word size divides the clocks of most assertions, so one cut short by a glitch doesn't take it down to a bit or two.
+    //Bytes are the most common, so take 8 whenever it fits
+    const U32 min_detect_bits = 4;
+    if ((mDetectAssertionClocks.empty() == false) && (DetectWordsFit(mSettings->mBitsPerTransfer) == false)) {
+        U32 bits = 8;
+        if (DetectWordsFit(8) == false) {
+            for (bits = 64; (bits >= min_detect_bits) && (DetectWordsFit(bits) == false); bits--) {
+            }
+        }
+        if (bits >= min_detect_bits) {
+            mSettings->mBitsPerTransfer = bits;
+            rerun = true;
+        }
+    }
+
+    if (rerun == true) {
+        mSettings->UpdateInterfacesFromSettings();
+    }
+    return rerun;
 }
 
 U32 SpiAnalyzer::GenerateSimulationData(U64 minimum_sample_index, U32 device_sample_rate, SimulationChannelDescriptor **simulation_channels)
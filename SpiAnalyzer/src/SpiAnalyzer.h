@@ -4,6 +4,9 @@
 #include <Analyzer.h>
 #include "SpiAnalyzerResults.h"
 #include "SpiSimulationDataGenerator.h"
+#include "SpiNorFlash.h"
+#include "SpiSdCard.h"
+#include "SpiDisplay.h"
 
 class SpiAnalyzerSettings;
 
@@ -23,12 +26,49 @@ public:
 
 protected: //functions
     void Setup();
+    void SelectWordReader();
     void AdvanceToActiveEnableEdge();
+    void AdvanceToNextSlaveAssertion(bool include_asserted);
     bool IsInitialClockPolarityCorrect();
     void AdvanceToActiveEnableEdgeWithCorrectClockPolarity();
     bool WouldAdvancingTheClockToggleEnable();
     void GetWord();
 
+    //standard SPI words of a common width, with the settings fixed at compile time; picked in Setup
+    enum SpiWordLines { MosiLine, MisoLine, MosiAndMisoLines };
+    typedef void (SpiAnalyzer::*WordReader)();
+    template <AnalyzerEnums::Edge DATA_VALID_EDGE, AnalyzerEnums::ShiftOrder SHIFT_ORDER, U32 BITS, SpiWordLines LINES> void GetFixedWord();
+    template <AnalyzerEnums::Edge DATA_VALID_EDGE, AnalyzerEnums::ShiftOrder SHIFT_ORDER, U32 BITS> WordReader SelectWordReaderForLines();
+    template <AnalyzerEnums::Edge DATA_VALID_EDGE, AnalyzerEnums::ShiftOrder SHIFT_ORDER> WordReader SelectWordReaderForWidth();
+    template <AnalyzerEnums::Edge DATA_VALID_EDGE> WordReader SelectWordReaderForOrder();
+
+    void AddWord(U64 starting_sample, U64 ending_sample, U64 mosi_word, U64 miso_word);
+    U32 GetPhaseClocks(U32 &lanes);
+    BitState SampleLine(U32 line, U64 sample);
+    U64 SampleLanes(U32 lanes, U64 sample);
+    U64 GetLaneSample(U64 previous_edge);
+    void AddPhaseWord(U64 starting_sample, U64 ending_sample, U64 mosi_word, U64 miso_word);
+    void AddDataWord(U64 starting_sample, U64 ending_sample, U64 mosi_word, U64 miso_word);
+    void ResetPhases();
+    void SelectNorCommand(U8 opcode);
+    U32 GetUsableLanes(U32 lanes);
+    void EndTransaction();
+    void AddResultFrame(const Frame &frame);
+    void AddDecodedFrames();
+    void AddArrowMarkers();
+    void AddRepeatWord(U64 starting_sample, U64 ending_sample, U64 mosi_word, U64 miso_word);
+    void ReleaseHeldFrames();
+    bool EndRepeatAssertion();
+    void AddRepeatFrame();
+    void AddDetectEdge(U64 previous_edge, U64 edge, bool leading);
+    void DetectSkippedAssertion();
+    void EndDetectAssertion();
+    bool DetectWordsFit(U32 bits);
+    void SampleIndependentLines(U64 sample);
+    void AddIndependentWord(U64 starting_sample, U64 ending_sample);
+    void AddWordTiming(U64 first_edge, U64 last_edge, U32 half_periods);
+    void EndTransactionTiming();
+
 #pragma warning( push )
 #pragma warning( disable : 4251 ) //warning C4251: 'SerialAnalyzer::<...>' : class <...> needs to have dll-interface to be used by clients of class
 protected:  //vars
@@ -40,12 +80,91 @@ protected:  //vars
     AnalyzerChannelData *mMosi;
     AnalyzerChannelData *mMiso;
     AnalyzerChannelData *mClock;
-    AnalyzerChannelData *mEnable;
+    AnalyzerChannelData *mEnable;    //the enable line of the current slave
+    AnalyzerChannelData *mEnables[SPI_MAX_SLAVES];
+    bool mMultiSlave;
+    U32 mSlave;
+    AnalyzerChannelData *mIo[SPI_MAX_LANES];
+    AnalyzerChannelData *mDqs;
+    bool mDtr;                          //octal DTR: the multi-line phases carry data on both clock edges
+    U32 mLaneLevels;                    //last level of every IO line, IO0 in bit 0...
+    U64 mLaneNextEdge[SPI_MAX_LANES];   //...valid until the line's next transition
+    U64 mLaneSample;                    //where the multi-line phases last sampled the IO lines
+    AnalyzerChannelData *mDc;           //display decoding: data/command select
+
+    enum SpiPhase { CommandPhase, AddressPhase, DummyPhase, DataPhase };
+    SpiPhase mPhase;    //dual/quad modes and SPI NOR decoding: where in the transaction the next word is
+
+    //shape of the current transaction; from the lane mode, and from the opcode when decoding SPI NOR commands
+    U32 mCommandLanes;
+    U32 mAddressLanes;
+    U32 mDataLanes;
+    U32 mPhaseAddressBytes;
+    U32 mPhaseDummyClocks;
+    const SpiNorCommand *mNorCommand;   //NULL if the opcode isn't known
+    U64 mNorAddress;                    //of the address phase
+    U64 mDataIndex;                     //data bytes so far in the transaction
+    SpiNorFlashImage mFlashImages[SPI_MAX_SLAVES];  //SPI NOR decoding: what the programs and erases left in each flash, to check reads against
 
     U64 mCurrentSample;
+    U64 mEnableDeassertSample;      //end of the current enable assertion, once it is in the captured data
+    bool mEnableDeassertKnown;
+    U64 mClockIdleTimeoutSamples;   //no enable line: a clock gap longer than this ends the transaction. 0 if not used
+    U64 mClockIdleSample;           //clock position of the last gap that ended a transaction
     AnalyzerResults::MarkerType mArrowMarker;
+    WordReader mWordReader;     //GetWord, or a GetFixedWord that matches the settings
+    U32 mUncommittedFrames;     //frames added since the last CommitResults
     std::vector<U64> mArrowLocations;
 
+    //transaction frames:
+    U64 mTransactionFirstWord;      //index in the results' payload buffers
+    U64 mTransactionWords;
+    U64 mTransactionStartingSample;
+    U64 mTransactionEndingSample;
+    bool mTransactionNorMismatch;   //a read byte of the transaction differs from the flash image
+
+    //timing statistics:
+    SpiTimingHistogram mTiming[SpiTimingMeasurementCount];
+    U64 mAssertSample;              //start of the current enable assertion
+    U64 mTimingWords;               //words of the current transaction so far
+    U64 mTimingLastEdge;            //last clock edge of the previous word
+    U64 mTimingSpanSamples;         //first to last clock edge of every word of the transaction...
+    U64 mTimingHalfPeriods;         //...and the clock half periods they span
+
+    //SD card and display decoding, one device per enable line:
+    SpiSdCardDecoder mSdCards[SPI_MAX_SLAVES];
+    SpiDisplayDecoder mDisplays[SPI_MAX_SLAVES];
+    std::vector<Frame> mDecodedFrames;  //completed by the last byte, not added to the results yet
+
+    //collapsing repeated transactions:
+    std::vector<U64> mRepeatWords;      //MOSI, MISO word pairs of the last transaction shown in full; empty if it is too long to compare
+    U32 mRepeatSlave;
+    U64 mRepeatCount;                   //transactions since then that repeated it
+    std::vector<U64> mRepeatStartingSamples;   //of every transaction of the run
+    U64 mRepeatEndingSample;
+    U64 mRepeatFirstWord;               //index of mRepeatWords in the payload buffers, once a run has started
+    std::vector<U64> mAssertionWords;   //the word pairs of the current enable assertion so far
+    U64 mAssertionFirstPayloadWord;
+    U64 mAssertionStartingSample;
+    U64 mAssertionEndingSample;
+    bool mAssertionRepeating;           //the current assertion matches mRepeatWords so far, so its frames and markers are held back
+    std::vector<Frame> mHeldFrames;
+    std::vector<U64> mHeldMarkers;
+
+    //clock mode and word size detection, over the first assertions:
+    bool mDetecting;
+    U32 mDetectAssertions;
+    U64 mDetectIdleLevels[2];           //assertions that found the clock low, and high
+    U64 mDetectValidEdges[2];           //data line transitions that point to the leading, and the trailing edge (AnalyzerEnums::Edge)
+    U32 mDetectClocks;                  //of the current assertion
+    std::vector<U32> mDetectAssertionClocks;    //of every assertion so far that had any
+    bool mDetectPartialAssertion;       //the current assertion was already under way when the capture started
+
+    //independent data lines:
+    U32 mIndependentLines;              //mask of the IO lines decoded as separate data lines, IO0 (MOSI) in bit 0. 0 if not used
+    U64 mLineWords[SPI_MAX_LANES];      //the current word of every line
+    DataBuilder mLineResults[SPI_MAX_LANES];
+
 #pragma warning( pop )
 };
 
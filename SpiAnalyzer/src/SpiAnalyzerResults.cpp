@@ -4,14 +4,76 @@
 #include "SpiAnalyzerSettings.h"
 #include <iostream>
 #include <sstream>
+#include <cstring>
 
 #pragma warning(disable: 4996) //warning C4996: 'sprintf': This function or variable may be unsafe. Consider using sprintf_s instead.
 
+namespace
+{
+    //collects the small writes of the binary export into large blocks for AppendToFile
+    class SpiBufferedFile
+    {
+    public:
+        explicit SpiBufferedFile(const std::string &file_name)
+            :   mFile(AnalyzerHelpers::StartFile(file_name.c_str(), true))
+        {
+            mBuffer.reserve(BUFFER_SIZE);
+        }
+
+        ~SpiBufferedFile()
+        {
+            Flush();
+            AnalyzerHelpers::EndFile(mFile);
+        }
+
+        void Append(const U8 *data, U64 length)
+        {
+            while (length != 0) {
+                U64 count = BUFFER_SIZE - mBuffer.size();
+                if (count > length) {
+                    count = length;
+                }
+                mBuffer.insert(mBuffer.end(), data, data + count);
+                data += count;
+                length -= count;
+
+                if (mBuffer.size() == BUFFER_SIZE) {
+                    Flush();
+                }
+            }
+        }
+
+        //the low byte_count bytes of value, least significant first
+        void AppendValue(U64 value, U32 byte_count)
+        {
+            U8 bytes[8];
+            for (U32 i = 0; i < byte_count; i++) {
+                bytes[i] = U8(value >> (8 * i));
+            }
+            Append(bytes, byte_count);
+        }
+
+    private:
+        void Flush()
+        {
+            if (mBuffer.empty() == false) {
+                AnalyzerHelpers::AppendToFile(&mBuffer[0], U32(mBuffer.size()), mFile);
+                mBuffer.clear();
+            }
+        }
+
+        enum { BUFFER_SIZE = 1 << 20 };
+        void *mFile;
+        std::vector<U8> mBuffer;
+    };
+}
+
 SpiAnalyzerResults::SpiAnalyzerResults(SpiAnalyzer *analyzer, SpiAnalyzerSettings *settings)
     :   AnalyzerResults(),
         mSettings(settings),
         mAnalyzer(analyzer)
 {
+    memset(mTimingHistograms, 0, sizeof(mTimingHistograms));
 }
 
 SpiAnalyzerResults::~SpiAnalyzerResults()
@@ -23,7 +85,40 @@ void SpiAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel &channel, D
     ClearResultStrings();
     Frame frame = GetFrame(frame_index);
 
-    if ((frame.mFlags & SPI_ERROR_FLAG) == 0) {
+    std::string phase_str = GetPhaseFrameText(frame, display_base);
+    if (phase_str.empty() == false) {
+        if (channel == GetPhaseFrameChannel(frame)) {
+            AddPhaseResultStrings(frame, display_base);
+        }
+        return;
+    }
+
+    if (SPI_FRAME_TYPE(frame.mType) == SpiLineWordsFrame) {    //the word of the line the bubble is on
+        for (U32 i = 0; i < SPI_MAX_LANES; i++) {
+            if (((frame.mData2 & (1 << i)) != 0) && (channel == mSettings->GetIoChannel(i))) {
+                char number_str[128];
+                AnalyzerHelpers::GetNumberString(GetLineWord(frame, i), display_base, mSettings->mBitsPerTransfer, number_str, 128);
+                AddResultString(number_str);
+            }
+        }
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiRepeatFrame) {
+        bool miso = (channel != mSettings->mMosiChannel);
+        std::stringstream ss;
+        ss << "x" << (frame.mData2 >> 32);
+        AddResultString(ss.str().c_str());
+        AddResultString(GetRepeatText(frame, miso, display_base, 4).c_str());
+        AddResultString(GetRepeatText(frame, miso, display_base, 16).c_str());
+    } else if (((frame.mFlags & SPI_ERROR_FLAG) == 0) && (SPI_FRAME_TYPE(frame.mType) == SpiTransactionFrame)) {
+        bool miso = (channel != mSettings->mMosiChannel);
+        std::stringstream ss;
+        ss << frame.mData2 << (frame.mData2 == 1 ? " word" : " words");
+        if ((frame.mFlags & SPI_NOR_MISMATCH_FLAG) != 0) {
+            ss << ", read differs from programmed";
+        }
+        AddResultString(ss.str().c_str());
+        AddResultString(GetPayloadText(frame.mData1, frame.mData2, miso, display_base, 4).c_str());
+        AddResultString(GetPayloadText(frame.mData1, frame.mData2, miso, display_base, 16).c_str());
+    } else if ((frame.mFlags & SPI_ERROR_FLAG) == 0) {
         if (channel == mSettings->mMosiChannel) {
             char number_str[128];
             AnalyzerHelpers::GetNumberString(frame.mData1, display_base, mSettings->mBitsPerTransfer, number_str, 128);
@@ -40,9 +135,24 @@ void SpiAnalyzerResults::GenerateBubbleText(U64 frame_index, Channel &channel, D
     }
 }
 
-void SpiAnalyzerResults::GenerateExportFile(const char *file, DisplayBase display_base, U32 /*export_type_user_id*/)
+void SpiAnalyzerResults::GenerateExportFile(const char *file, DisplayBase display_base, U32 export_type_user_id)
 {
-    //export_type_user_id is only important if we have more than one export type.
+    if (export_type_user_id == 1) {
+        GenerateTimingExportFile(file);
+        return;
+    }
+    if (export_type_user_id == 2) {
+        GenerateDisplayExportFile(file);
+        return;
+    }
+    if (export_type_user_id == 3) {
+        GenerateBinaryExportFile(file);
+        return;
+    }
+    if (export_type_user_id == 4) {
+        GenerateFlashImageExportFile(file);
+        return;
+    }
 
     std::stringstream ss;
     void *f = AnalyzerHelpers::StartFile(file);
@@ -50,7 +160,24 @@ void SpiAnalyzerResults::GenerateExportFile(const char *file, DisplayBase displa
     U64 trigger_sample = mAnalyzer->GetTriggerSample();
     U32 sample_rate = mAnalyzer->GetSampleRate();
 
-    ss << "Time [s],Packet ID,MOSI,MISO" << std::endl;
+    bool multi_slave = mSettings->IsMultiSlave();
+    if (multi_slave == true) {
+        ss << "Time [s],Packet ID,Slave,MOSI,MISO";
+    } else {
+        ss << "Time [s],Packet ID,MOSI,MISO";
+    }
+
+    //independent data lines: a column for each of IO2-IO7 that is used
+    U32 extra_lines = 0;
+    if (mSettings->mIndependentLines == true) {
+        for (U32 i = 2; i < SPI_MAX_LANES; i++) {
+            if (mSettings->GetIoChannel(i) != UNDEFINED_CHANNEL) {
+                extra_lines |= 1 << i;
+                ss << "," << GetLineName(i);
+            }
+        }
+    }
+    ss << std::endl;
 
     bool mosi_used = true;
     bool miso_used = true;
@@ -74,22 +201,77 @@ void SpiAnalyzerResults::GenerateExportFile(const char *file, DisplayBase displa
         char time_str[128];
         AnalyzerHelpers::GetTimeString(frame.mStartingSampleInclusive, trigger_sample, sample_rate, time_str, 128);
 
-        char mosi_str[128] = "";
-        if (mosi_used == true) {
-            AnalyzerHelpers::GetNumberString(frame.mData1, display_base, mSettings->mBitsPerTransfer, mosi_str, 128);
-        }
+        std::string mosi_str;
+        std::string miso_str;
+        std::string extra_str;
+        std::string phase_str = GetPhaseFrameText(frame, display_base);
+        if (phase_str.empty() == false) {
+            if ((SPI_FRAME_TYPE(frame.mType) == SpiSdBlockFrame) || (SPI_FRAME_TYPE(frame.mType) == SpiDisplayPixelFrame)) {   //the whole block after its description
+                U64 data_length = (frame.mData2 >> 8) & 0xFFFFFF;
+                bool miso = (GetPhaseFrameChannel(frame) == mSettings->mMisoChannel);
+                phase_str += ": " + GetPayloadText(frame.mData1, data_length, miso, display_base, 0);
+            }
 
-        char miso_str[128] = "";
-        if (miso_used == true) {
-            AnalyzerHelpers::GetNumberString(frame.mData2, display_base, mSettings->mBitsPerTransfer, miso_str, 128);
+            if (GetPhaseFrameChannel(frame) == mSettings->mMisoChannel) {
+                miso_str = phase_str;
+            } else {
+                mosi_str = phase_str;
+            }
+        } else if (SPI_FRAME_TYPE(frame.mType) == SpiLineWordsFrame) {     //the word of every line in its own column
+            char number_str[128];
+            if (mosi_used == true) {
+                AnalyzerHelpers::GetNumberString(GetLineWord(frame, 0), display_base, mSettings->mBitsPerTransfer, number_str, 128);
+                mosi_str = number_str;
+            }
+            if (miso_used == true) {
+                AnalyzerHelpers::GetNumberString(GetLineWord(frame, 1), display_base, mSettings->mBitsPerTransfer, number_str, 128);
+                miso_str = number_str;
+            }
+            for (U32 j = 2; j < SPI_MAX_LANES; j++) {
+                if ((extra_lines & (1 << j)) != 0) {
+                    AnalyzerHelpers::GetNumberString(GetLineWord(frame, j), display_base, mSettings->mBitsPerTransfer, number_str, 128);
+                    extra_str += ",";
+                    extra_str += number_str;
+                }
+            }
+        } else if (SPI_FRAME_TYPE(frame.mType) == SpiRepeatFrame) {   //the words of the transaction and the repeat count
+            if (mosi_used == true) {
+                mosi_str = GetRepeatText(frame, false, display_base, 0);
+            }
+            if (miso_used == true) {
+                miso_str = GetRepeatText(frame, true, display_base, 0);
+            }
+        } else if (SPI_FRAME_TYPE(frame.mType) == SpiTransactionFrame) {   //all the words of the transaction, space separated
+            if (mosi_used == true) {
+                mosi_str = GetPayloadText(frame.mData1, frame.mData2, false, display_base, 0);
+            }
+            if (miso_used == true) {
+                miso_str = GetPayloadText(frame.mData1, frame.mData2, true, display_base, 0);
+            }
+        } else {
+            char number_str[128];
+            if (mosi_used == true) {
+                AnalyzerHelpers::GetNumberString(frame.mData1, display_base, mSettings->mBitsPerTransfer, number_str, 128);
+                mosi_str = number_str;
+            }
+            if (miso_used == true) {
+                AnalyzerHelpers::GetNumberString(frame.mData2, display_base, mSettings->mBitsPerTransfer, number_str, 128);
+                miso_str = number_str;
+            }
         }
 
+        ss << time_str << ",";
+
         U64 packet_id = GetPacketContainingFrameSequential(i);
-        if (packet_id != INVALID_RESULT_INDEX) {
-            ss << time_str << "," << packet_id << "," << mosi_str << "," << miso_str << std::endl;
-        } else {
-            ss << time_str << ",," << mosi_str << "," << miso_str << std::endl;    //it's ok for a frame not to be included in a packet.
+        if (packet_id != INVALID_RESULT_INDEX) {    //it's ok for a frame not to be included in a packet.
+            ss << packet_id;
+        }
+        ss << ",";
+
+        if (multi_slave == true) {  //1 for the Enable channel, 2 for Enable 2, ...
+            ss << SPI_FRAME_SLAVE(frame.mType) + 1 << ",";
         }
+        ss << mosi_str << "," << miso_str << extra_str << std::endl;
 
         AnalyzerHelpers::AppendToFile((U8 *)ss.str().c_str(), ss.str().length(), f);
         ss.str(std::string());
@@ -124,8 +306,46 @@ void SpiAnalyzerResults::GenerateFrameTabularText(U64 frame_index, DisplayBase d
     char miso_str[128];
 
     std::stringstream ss;
+    if (mSettings->IsMultiSlave() == true) {    //name the slave, since the table mixes them
+        ss << "Slave " << SPI_FRAME_SLAVE(frame.mType) + 1 << ": ";
+    }
 
-    if ((frame.mFlags & SPI_ERROR_FLAG) == 0) {
+    std::string phase_str = GetPhaseFrameText(frame, display_base);
+    if (phase_str.empty() == false) {
+        ss << phase_str;
+        if ((SPI_FRAME_TYPE(frame.mType) == SpiSdBlockFrame) || (SPI_FRAME_TYPE(frame.mType) == SpiDisplayPixelFrame)) {
+            U64 data_length = (frame.mData2 >> 8) & 0xFFFFFF;
+            bool miso = (GetPhaseFrameChannel(frame) == mSettings->mMisoChannel);
+            ss << ": " << GetPayloadText(frame.mData1, data_length, miso, display_base, 16);
+        }
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiLineWordsFrame) {
+        bool first = true;
+        for (U32 i = 0; i < SPI_MAX_LANES; i++) {
+            if ((frame.mData2 & (1 << i)) != 0) {
+                char number_str[128];
+                AnalyzerHelpers::GetNumberString(GetLineWord(frame, i), display_base, mSettings->mBitsPerTransfer, number_str, 128);
+                ss << (first == true ? "" : ";  ") << GetLineName(i) << ": " << number_str;
+                first = false;
+            }
+        }
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiRepeatFrame) {
+        U64 repeats = frame.mData2 >> 32;
+        ss << "Repeated " << repeats << (repeats == 1 ? " time" : " times");
+        if (mosi_used == true) {
+            ss << ";  MOSI: " << GetPayloadText(frame.mData1, frame.mData2 & 0xFFFFFFFF, false, display_base, 16);
+        }
+        if (miso_used == true) {
+            ss << ";  MISO: " << GetPayloadText(frame.mData1, frame.mData2 & 0xFFFFFFFF, true, display_base, 16);
+        }
+    } else if (((frame.mFlags & SPI_ERROR_FLAG) == 0) && (SPI_FRAME_TYPE(frame.mType) == SpiTransactionFrame)) {
+        ss << frame.mData2 << (frame.mData2 == 1 ? " word" : " words");
+        if (mosi_used == true) {
+            ss << ";  MOSI: " << GetPayloadText(frame.mData1, frame.mData2, false, display_base, 16);
+        }
+        if (miso_used == true) {
+            ss << ";  MISO: " << GetPayloadText(frame.mData1, frame.mData2, true, display_base, 16);
+        }
+    } else if ((frame.mFlags & SPI_ERROR_FLAG) == 0) {
         if (mosi_used == true) {
             AnalyzerHelpers::GetNumberString(frame.mData1, display_base, mSettings->mBitsPerTransfer, mosi_str, 128);
         }
@@ -160,3 +380,784 @@ void SpiAnalyzerResults::GenerateTransactionTabularText(U64 /*transaction_id*/,
     ClearResultStrings();
     AddResultString("not supported");
 }
+
+U64 SpiAnalyzerResults::GetPayloadWordCount()
+{
+    U32 bytes_per_word = (mSettings->mBitsPerTransfer + 7) / 8;
+
+    std::lock_guard<std::mutex> lock(mPayloadMutex);
+    return mMosiPayload.size() / bytes_per_word;
+}
+
+void SpiAnalyzerResults::AddPayloadWord(U64 mosi_word, U64 miso_word)
+{
+    U32 bytes_per_word = (mSettings->mBitsPerTransfer + 7) / 8;
+
+    std::lock_guard<std::mutex> lock(mPayloadMutex);
+    for (U32 i = 0; i < bytes_per_word; i++) {
+        mMosiPayload.push_back(U8(mosi_word >> (8 * i)));
+        mMisoPayload.push_back(U8(miso_word >> (8 * i)));
+    }
+}
+
+void SpiAnalyzerResults::GetPayloadWords(U64 first_word, U64 count, std::vector<U64> &mosi_words, std::vector<U64> &miso_words)
+{
+    U32 bytes_per_word = (mSettings->mBitsPerTransfer + 7) / 8;
+
+    mosi_words.resize(count);
+    miso_words.resize(count);
+
+    std::lock_guard<std::mutex> lock(mPayloadMutex);
+    for (U64 i = 0; i < count; i++) {
+        U64 offset = (first_word + i) * bytes_per_word;
+        U64 mosi_word = 0;
+        U64 miso_word = 0;
+        for (U32 j = 0; j < bytes_per_word; j++) {
+            mosi_word |= U64(mMosiPayload[offset + j]) << (8 * j);
+            miso_word |= U64(mMisoPayload[offset + j]) << (8 * j);
+        }
+        mosi_words[i] = mosi_word;
+        miso_words[i] = miso_word;
+    }
+}
+
+//drops the words from first_word on; no frame may refer to them
+void SpiAnalyzerResults::RemovePayloadWords(U64 first_word)
+{
+    U32 bytes_per_word = (mSettings->mBitsPerTransfer + 7) / 8;
+
+    std::lock_guard<std::mutex> lock(mPayloadMutex);
+    if (mMosiPayload.size() > first_word * bytes_per_word) {
+        mMosiPayload.resize(first_word * bytes_per_word);
+        mMisoPayload.resize(first_word * bytes_per_word);
+    }
+}
+
+void SpiAnalyzerResults::AddRepeatStartingSamples(const std::vector<U64> &samples)
+{
+    std::lock_guard<std::mutex> lock(mPayloadMutex);
+    mRepeatStartingSamples.insert(mRepeatStartingSamples.end(), samples.begin(), samples.end());
+}
+
+void SpiAnalyzerResults::UpdateTimingStatistics(const SpiTimingHistogram *histograms)
+{
+    std::lock_guard<std::mutex> lock(mTimingMutex);
+    memcpy(mTimingHistograms, histograms, sizeof(mTimingHistograms));
+}
+
+//a summary row per measurement, then the non-empty bins of each histogram
+void SpiAnalyzerResults::GenerateTimingExportFile(const char *file)
+{
+    SpiTimingHistogram histograms[SpiTimingMeasurementCount];
+    {
+        std::lock_guard<std::mutex> lock(mTimingMutex);
+        memcpy(histograms, mTimingHistograms, sizeof(histograms));
+    }
+
+    const char *names[SpiTimingMeasurementCount] = { "SCK period", "Enable to first clock", "Last clock to enable release", "Gap between words" };
+    double seconds_per_sample = 1.0 / double(mAnalyzer->GetSampleRate());
+
+    void *f = AnalyzerHelpers::StartFile(file);
+
+    std::stringstream ss;
+    ss << "Measurement,Count,Minimum [s],Mean [s],Maximum [s]" << std::endl;
+    for (U32 i = 0; i < SpiTimingMeasurementCount; i++) {
+        const SpiTimingHistogram &histogram = histograms[i];
+        ss << names[i] << "," << histogram.mCount;
+        if (histogram.mCount != 0) {
+            ss << "," << double(histogram.mMinimum) * seconds_per_sample;
+            ss << "," << double(histogram.mTotal) / double(histogram.mCount) * seconds_per_sample;
+            ss << "," << double(histogram.mMaximum) * seconds_per_sample;
+        }
+        ss << std::endl;
+    }
+
+    ss << std::endl << "Measurement,From [s],To [s],Count" << std::endl;
+    for (U32 i = 0; i < SpiTimingMeasurementCount; i++) {
+        for (U32 bin = 0; bin < 64; bin++) {
+            if (histograms[i].mBins[bin] == 0) {
+                continue;
+            }
+
+            double from = (bin == 0) ? 0.0 : double(1ull << bin) * seconds_per_sample;
+            double to = double(1ull << bin) * 2.0 * seconds_per_sample;
+            ss << names[i] << "," << from << "," << to << "," << histograms[i].mBins[bin] << std::endl;
+        }
+    }
+
+    AnalyzerHelpers::AppendToFile((U8 *)ss.str().c_str(), ss.str().length(), f);
+
+    UpdateExportProgressAndCheckForCancel(1, 1);
+    AnalyzerHelpers::EndFile(f);
+}
+
+//command, address, dummy, SPI NOR data, SD card and display controller frames; empty for other frames
+std::string SpiAnalyzerResults::GetPhaseFrameText(const Frame &frame, DisplayBase display_base)
+{
+    if (IsSdFrame(frame) == true) {
+        return GetSdFrameText(frame, display_base);
+    }
+    if (IsDisplayFrame(frame) == true) {
+        return GetDisplayFrameText(frame, display_base);
+    }
+
+    std::stringstream ss;
+    char number_str[128];
+    const SpiNorCommand *command = GetNorCommand(frame);
+
+    if (SPI_FRAME_TYPE(frame.mType) == SpiCommandFrame) {
+        AnalyzerHelpers::GetNumberString(frame.mData1, display_base, U32(8 * frame.mData2), number_str, 128);
+        ss << "Command " << number_str;
+        if (command != NULL) {
+            ss << " (" << command->mName << ")";
+        }
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiAddressFrame) {
+        AnalyzerHelpers::GetNumberString(frame.mData1, display_base, U32(8 * frame.mData2), number_str, 128);
+        ss << "Address " << number_str;
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiDummyFrame) {
+        ss << frame.mData2 << " dummy clocks";
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiDataFrame) {
+        AnalyzerHelpers::GetNumberString(frame.mData1, display_base, 8, number_str, 128);
+        ss << GetNorDataLabel(frame) << " " << number_str;
+
+        //status register 1: write in progress and write enable latch
+        if (command->mOpcode == 0x05) {
+            if ((frame.mData1 & 0x1) != 0) {
+                ss << ", WIP";
+            }
+            if ((frame.mData1 & 0x2) != 0) {
+                ss << ", WEL";
+            }
+        }
+
+        if ((frame.mFlags & SPI_NOR_MISMATCH_FLAG) != 0) {
+            AnalyzerHelpers::GetNumberString(U8(frame.mData2 >> 40), display_base, 8, number_str, 128);
+            ss << ", programmed " << number_str;
+        }
+    }
+
+    return ss.str();
+}
+
+//bubble text of the phase frames, shortest first
+void SpiAnalyzerResults::AddPhaseResultStrings(const Frame &frame, DisplayBase display_base)
+{
+    const SpiNorCommand *command = GetNorCommand(frame);
+    char number_str[128];
+
+    if (SPI_FRAME_TYPE(frame.mType) == SpiCommandFrame) {
+        AnalyzerHelpers::GetNumberString(frame.mData1, display_base, U32(8 * frame.mData2), number_str, 128);
+        AddResultString(number_str);
+        if (command != NULL) {
+            AddResultString(command->mName);
+        }
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiDataFrame) {
+        AnalyzerHelpers::GetNumberString(frame.mData1, display_base, 8, number_str, 128);
+        AddResultString(number_str);
+        AddResultString(GetNorDataLabel(frame).c_str(), " ", number_str);
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiSdCommandFrame) {
+        AddResultString(GetSdCommandLabel(U8(frame.mData2)).c_str());
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiDisplayCommandFrame) {
+        AddResultString(GetDisplayCommandLabel(U8(frame.mData1), display_base).c_str());
+    } else if ((SPI_FRAME_TYPE(frame.mType) == SpiSdBlockFrame) || (SPI_FRAME_TYPE(frame.mType) == SpiDisplayPixelFrame)) {
+        std::stringstream ss;
+        ss << ((frame.mData2 >> 8) & 0xFFFFFF) << " bytes";
+        AddResultString(ss.str().c_str());
+    }
+
+    AddResultString(GetPhaseFrameText(frame, display_base).c_str());
+}
+
+//data from the flash or SD card, the card's responses and tokens, and what a display controller reads back are shown on MISO;
+//everything else on MOSI (IO0)
+Channel SpiAnalyzerResults::GetPhaseFrameChannel(const Frame &frame)
+{
+    if ((SPI_FRAME_TYPE(frame.mType) == SpiDataFrame) && (GetNorCommand(frame)->mDataFromFlash == true)) {
+        return mSettings->mMisoChannel;
+    }
+
+    if ((SPI_FRAME_TYPE(frame.mType) == SpiSdResponseFrame) || ((SPI_FRAME_TYPE(frame.mType) == SpiSdTokenFrame) && (frame.mData1 != 0xFD))) {
+        return mSettings->mMisoChannel;
+    }
+    if (SPI_FRAME_TYPE(frame.mType) == SpiSdBlockFrame) {
+        const SpiSdCommand *command = GetSpiSdCommand(U8(frame.mData2));
+        if ((command == NULL) || (command->mData != SpiSdDataToCard)) {
+            return mSettings->mMisoChannel;
+        }
+    }
+    if ((SPI_FRAME_TYPE(frame.mType) == SpiDisplayParameterFrame) && (mSettings->mMisoChannel != UNDEFINED_CHANNEL)) {
+        const SpiDisplayCommand *command = GetSpiDisplayCommand(U8(frame.mData2));
+        if ((command != NULL) && (command->mRead == true)) {
+            return mSettings->mMisoChannel;
+        }
+    }
+
+    return mSettings->mMosiChannel;
+}
+
+//the SPI NOR command a command or data frame belongs to; NULL for other frames and unknown opcodes
+const SpiNorCommand *SpiAnalyzerResults::GetNorCommand(const Frame &frame)
+{
+    if ((SPI_FRAME_TYPE(frame.mType) == SpiCommandFrame) && (mSettings->mNorCommands == true)) {
+        return GetSpiNorCommand(U8(frame.mData1 >> (8 * (frame.mData2 - 1))));    //octal DTR: the opcode, then its extension
+    }
+    if (SPI_FRAME_TYPE(frame.mType) == SpiDataFrame) {
+        return GetSpiNorCommand(U8(frame.mData2 >> 32));
+    }
+
+    return NULL;
+}
+
+//what a data byte is, going by its command and place in the data phase
+std::string SpiAnalyzerResults::GetNorDataLabel(const Frame &frame)
+{
+    const SpiNorCommand *command = GetNorCommand(frame);
+    U32 index = U32(frame.mData2);
+
+    switch (command->mKind) {
+    case SpiNorRead:
+        return "Read";
+    case SpiNorProgram:
+        return "Program";
+    case SpiNorStatus:
+        return "Status";
+    case SpiNorId:
+        if (index == 0) {
+            return "Manufacturer";
+        }
+        if (command->mOpcode != 0x9F) {
+            return "Device ID";
+        }
+        if (index == 1) {
+            return "Memory type";
+        }
+        if (index == 2) {
+            return "Capacity";
+        }
+        return "ID";
+    default:
+        return "Data";
+    }
+}
+
+bool SpiAnalyzerResults::IsSdFrame(const Frame &frame)
+{
+    U8 type = SPI_FRAME_TYPE(frame.mType);
+    return (type == SpiSdCommandFrame) || (type == SpiSdResponseFrame) || (type == SpiSdBlockFrame) || (type == SpiSdTokenFrame);
+}
+
+std::string SpiAnalyzerResults::GetSdFrameText(const Frame &frame, DisplayBase display_base)
+{
+    std::stringstream ss;
+    char number_str[128];
+    U8 key = U8(frame.mData2);
+    const SpiSdCommand *command = GetSpiSdCommand(key);
+
+    if (SPI_FRAME_TYPE(frame.mType) == SpiSdCommandFrame) {
+        ss << GetSdCommandLabel(key);
+        if (command != NULL) {
+            ss << " " << command->mName;
+        }
+        AnalyzerHelpers::GetNumberString(frame.mData1, display_base, 32, number_str, 128);
+        ss << ", argument " << number_str;
+        if ((frame.mFlags & SPI_SD_CHECK_ERROR_FLAG) != 0) {
+            ss << ", CRC7 error";
+        }
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiSdResponseFrame) {
+        const char *response_names[] = { "R1", "R1b", "R2", "R3", "R7" };   //indexed by SpiSdResponseType
+        const char *r1_bits[] = { "idle", "erase reset", "illegal command", "CRC error", "erase sequence error", "address error", "parameter error" };
+        U32 length = U32(frame.mData2 >> 8) & 0xFF;
+        U8 r1 = U8(frame.mData1 >> (8 * (length - 1)));
+
+        AnalyzerHelpers::GetNumberString(r1, display_base, 8, number_str, 128);
+        ss << response_names[(command != NULL) ? command->mResponse : SpiSdR1] << " " << number_str;
+        if (length == 2) {
+            AnalyzerHelpers::GetNumberString(frame.mData1 & 0xFF, display_base, 8, number_str, 128);
+            ss << " " << number_str;
+        } else if (length == 5) {
+            AnalyzerHelpers::GetNumberString(frame.mData1 & 0xFFFFFFFF, display_base, 32, number_str, 128);
+            ss << (((command != NULL) && (command->mResponse == SpiSdR3)) ? ", OCR " : ", ") << number_str;
+        }
+
+        for (U32 i = 0; i < 7; i++) {
+            if ((r1 & (1 << i)) != 0) {
+                ss << ", " << r1_bits[i];
+            }
+        }
+    } else if (SPI_FRAME_TYPE(frame.mType) == SpiSdBlockFrame) {
+        bool write = ((command != NULL) && (command->mData == SpiSdDataToCard));
+        ss << (write == true ? "Write block (" : "Read block (") << GetSdCommandLabel(key) << "), " << ((frame.mData2 >> 8) & 0xFFFFFF) << " bytes";
+        if ((frame.mFlags & SPI_SD_INCOMPLETE_FLAG) != 0) {
+            ss << ", stopped";
+        } else if ((frame.mFlags & SPI_SD_CHECK_ERROR_FLAG) != 0) {
+            ss << ", CRC16 error";
+        }
+    } else {
+        U8 token = U8(frame.mData1);
+        AnalyzerHelpers::GetNumberString(token, display_base, 8, number_str, 128);
+
+        if (token == 0xFD) {
+            ss << "Stop transmission token";
+        } else if ((token & 0x11) == 0x01) {    //data response: xxx0sss1
+            U8 status = (token >> 1) & 0x7;
+            if (status == 2) {
+                ss << "Data accepted";
+            } else if (status == 5) {
+                ss << "Data rejected, CRC error";
+            } else if (status == 6) {
+                ss << "Data rejected, write error";
+            } else {
+                ss << "Data response " << number_str;
+            }
+        } else {
+            const char *error_bits[] = { "error", "CC error", "card ECC failed", "out of range" };
+            ss << "Data error token " << number_str;
+            for (U32 i = 0; i < 4; i++) {
+                if ((token & (1 << i)) != 0) {
+                    ss << ", " << error_bits[i];
+                }
+            }
+        }
+    }
+
+    return ss.str();
+}
+
+//CMD17, ACMD41, ...
+std::string SpiAnalyzerResults::GetSdCommandLabel(U8 key)
+{
+    std::stringstream ss;
+    if ((key & SPI_SD_APP_COMMAND) != 0) {
+        ss << "ACMD" << U32(key - SPI_SD_APP_COMMAND);
+    } else {
+        ss << "CMD" << U32(key);
+    }
+    return ss.str();
+}
+
+bool SpiAnalyzerResults::IsDisplayFrame(const Frame &frame)
+{
+    U8 type = SPI_FRAME_TYPE(frame.mType);
+    return (type == SpiDisplayCommandFrame) || (type == SpiDisplayParameterFrame) || (type == SpiDisplayPixelFrame);
+}
+
+std::string SpiAnalyzerResults::GetDisplayFrameText(const Frame &frame, DisplayBase display_base)
+{
+    std::stringstream ss;
+    char number_str[128];
+
+    if (SPI_FRAME_TYPE(frame.mType) == SpiDisplayCommandFrame) {
+        const SpiDisplayCommand *command = GetSpiDisplayCommand(U8(frame.mData1));
+        AnalyzerHelpers::GetNumberString(frame.mData1, display_base, 8, number_str, 128);
+        ss << "Command " << number_str;
+        if (command != NULL) {
+            ss << " (" << command->mMnemonic << ", " << command->mName << ")";
+        }
+        return ss.str();
+    }
+
+    U8 opcode = U8(frame.mData2);
+    U32 length = U32(frame.mData2 >> 8) & 0xFFFFFF;
+    U32 first_index = U32(frame.mData2 >> 32);
+
+    if (SPI_FRAME_TYPE(frame.mType) == SpiDisplayPixelFrame) {
+        ss << GetDisplayCommandLabel(opcode, display_base) << " data, " << length << " bytes";
+        return ss.str();
+    }
+
+    ss << GetDisplayCommandLabel(opcode, display_base) << ((first_index != 0) ? " (continued):" : ":");
+    for (U32 i = 0; i < length; i++) {
+        AnalyzerHelpers::GetNumberString((frame.mData1 >> (8 * (length - 1 - i))) & 0xFF, display_base, 8, number_str, 128);
+        ss << " " << number_str;
+    }
+
+    //what the window, pixel format and memory access parameters set
+    if (first_index != 0) {
+        return ss.str();
+    }
+    if (((opcode == 0x2A) || (opcode == 0x2B)) && (length == 4)) {
+        ss << ((opcode == 0x2A) ? ", columns " : ", rows ") << ((frame.mData1 >> 16) & 0xFFFF) << " to " << (frame.mData1 & 0xFFFF);
+    } else if (opcode == 0x3A) {
+        U8 format = U8(frame.mData1 >> (8 * (length - 1))) & 0x7;
+        if (format == 0x3) {
+            ss << ", 12 bits per pixel";
+        } else if (format == 0x5) {
+            ss << ", 16 bits per pixel";
+        } else if (format == 0x6) {
+            ss << ", 18 bits per pixel";
+        }
+    } else if (opcode == 0x36) {
+        const char *bits[] = { NULL, NULL, "MH", "BGR", "ML", "MV", "MX", "MY" };
+        U8 value = U8(frame.mData1 >> (8 * (length - 1)));
+        for (U32 i = 7; i >= 2; i--) {
+            if ((value & (1 << i)) != 0) {
+                ss << ", " << bits[i];
+            }
+        }
+    }
+
+    return ss.str();
+}
+
+//CASET, RAMWR, ...; the opcode for commands that aren't in the table
+std::string SpiAnalyzerResults::GetDisplayCommandLabel(U8 opcode, DisplayBase display_base)
+{
+    const SpiDisplayCommand *command = GetSpiDisplayCommand(opcode);
+    if (command != NULL) {
+        return command->mMnemonic;
+    }
+
+    char number_str[128];
+    AnalyzerHelpers::GetNumberString(opcode, display_base, 8, number_str, 128);
+    return std::string("Command ") + number_str;
+}
+
+//the first max_words words of a transaction frame or SD card block, or all of them if max_words is 0
+std::string SpiAnalyzerResults::GetPayloadText(U64 first_word, U64 word_count, bool miso, DisplayBase display_base, U64 max_words)
+{
+    U64 count = word_count;
+    if ((max_words != 0) && (count > max_words)) {
+        count = max_words;
+    }
+
+    std::vector<U64> mosi_words;
+    std::vector<U64> miso_words;
+    GetPayloadWords(first_word, count, mosi_words, miso_words);
+    const std::vector<U64> &words = (miso == true) ? miso_words : mosi_words;
+
+    std::stringstream ss;
+    for (U64 i = 0; i < count; i++) {
+        char number_str[128];
+        AnalyzerHelpers::GetNumberString(words[i], display_base, mSettings->mBitsPerTransfer, number_str, 128);
+        if (i != 0) {
+            ss << " ";
+        }
+        ss << number_str;
+    }
+
+    if (count < word_count) {
+        ss << " ...";
+    }
+
+    return ss.str();
+}
+
+//the words of a repeat frame's transaction on one side, then the repeat count: "05 00 x48213"
+std::string SpiAnalyzerResults::GetRepeatText(const Frame &frame, bool miso, DisplayBase display_base, U64 max_words)
+{
+    std::stringstream ss;
+    ss << GetPayloadText(frame.mData1, frame.mData2 & 0xFFFFFFFF, miso, display_base, max_words) << " x" << (frame.mData2 >> 32);
+    return ss.str();
+}
+
+//the word of IO line 'line' in a line word frame
+U64 SpiAnalyzerResults::GetLineWord(const Frame &frame, U32 line)
+{
+    std::vector<U64> mosi_words;
+    std::vector<U64> miso_words;
+    GetPayloadWords(frame.mData1 + line / 2, 1, mosi_words, miso_words);
+    return ((line & 1) != 0) ? miso_words[0] : mosi_words[0];
+}
+
+std::string SpiAnalyzerResults::GetLineName(U32 line)
+{
+    if (line == 0) {
+        return "MOSI";
+    }
+    if (line == 1) {
+        return "MISO";
+    }
+
+    std::stringstream ss;
+    ss << "IO" << line;
+    return ss.str();
+}
+
+//Rebuilds the frame memory of each display from its frames, and writes it as a PPM image whenever a frame is complete: when the host
+//draws a pixel it has drawn since the last image. The images are numbered after the name of the export file: image_0001.ppm, ...
+void SpiAnalyzerResults::GenerateDisplayExportFile(const char *file)
+{
+    std::string base;
+    std::string extension;
+    SplitExportFileName(file, ".ppm", base, extension);
+
+    bool multi_slave = mSettings->IsMultiSlave();
+    std::vector<SpiDisplayFramebuffer> framebuffers(SPI_MAX_SLAVES, SpiDisplayFramebuffer(mSettings->mDisplayWidth, mSettings->mDisplayHeight));
+    U32 image_counts[SPI_MAX_SLAVES] = { 0 };
+    std::vector<U8> ppm;
+
+    //pixel data is read from the payload buffers a chunk at a time
+    const U64 chunk_words = 65536;
+    std::vector<U64> mosi_words;
+    std::vector<U64> miso_words;
+
+    U64 num_frames = GetNumFrames();
+    for (U64 i = 0; i <= num_frames; i++) {
+        //after the last frame, the frames that are drawn but not complete
+        bool last = (i == num_frames);
+        Frame frame;
+        if (last == false) {
+            frame = GetFrame(i);
+            if (IsDisplayFrame(frame) == false) {
+                continue;
+            }
+        }
+
+        for (U32 slave = 0; slave < SPI_MAX_SLAVES; slave++) {
+            if ((last == false) && (slave != SPI_FRAME_SLAVE(frame.mType))) {
+                continue;
+            }
+            SpiDisplayFramebuffer &framebuffer = framebuffers[slave];
+
+            U64 first_word = 0;
+            U64 length = 0;
+            if (last == true) {
+                if (framebuffer.IsDrawn() == false) {
+                    continue;
+                }
+            } else if (SPI_FRAME_TYPE(frame.mType) == SpiDisplayCommandFrame) {
+                framebuffer.AddCommand(U8(frame.mData1));
+                continue;
+            } else if (SPI_FRAME_TYPE(frame.mType) == SpiDisplayParameterFrame) {
+                length = (frame.mData2 >> 8) & 0xFFFFFF;
+                for (U32 j = 0; j < length; j++) {
+                    framebuffer.AddParameter(U8(frame.mData2), U32(frame.mData2 >> 32) + j, U8(frame.mData1 >> (8 * (length - 1 - j))));
+                }
+                continue;
+            } else {
+                first_word = frame.mData1;
+                length = (frame.mData2 >> 8) & 0xFFFFFF;
+            }
+
+            //pixel data: an image every time a frame completes, and once at the end
+            U64 done = 0;
+            for (; ;) {
+                bool complete = last;
+                while ((complete == false) && (done < length)) {
+                    U64 index = done % chunk_words;
+                    if (index == 0) {
+                        U64 count = (length - done < chunk_words) ? (length - done) : chunk_words;
+                        GetPayloadWords(first_word + done, count, mosi_words, miso_words);
+                    }
+                    complete = framebuffer.AddPixelByte(U8(mosi_words[index]));
+                    done++;
+                }
+                if (complete == false) {
+                    break;
+                }
+
+                std::stringstream ss;
+                ss << base << "_";
+                if (multi_slave == true) {
+                    ss << slave + 1 << "_";
+                }
+                image_counts[slave]++;
+                ss.width(4);
+                ss.fill('0');
+                ss << image_counts[slave] << extension;
+
+                framebuffer.GetImage(ppm);
+                void *f = AnalyzerHelpers::StartFile(ss.str().c_str(), true);
+                AnalyzerHelpers::AppendToFile(&ppm[0], U32(ppm.size()), f);
+                AnalyzerHelpers::EndFile(f);
+
+                framebuffer.StartFrame();
+                if (last == true) {
+                    break;
+                }
+            }
+        }
+
+        if ((last == false) && (UpdateExportProgressAndCheckForCancel(i, num_frames) == true)) {
+            return;
+        }
+    }
+
+    UpdateExportProgressAndCheckForCancel(num_frames, num_frames);
+}
+
+//The raw words of every enable assertion, for tools that want the bytes rather than text. Named after the export file:
+//name_mosi.bin and name_miso.bin hold the words back to back, (bits per transfer + 7) / 8 bytes each, least significant first;
+//name_index.bin has a 64 bit starting sample and a 64 bit length in bytes per enable assertion, little endian.
+//Only word, transaction and repeat frames are exported; the frames of the decoding modes don't hold the raw words.
+void SpiAnalyzerResults::GenerateBinaryExportFile(const char *file)
+{
+    std::string base;
+    std::string extension;
+    SplitExportFileName(file, ".bin", base, extension);
+
+    SpiBufferedFile mosi_file(base + "_mosi" + extension);
+    SpiBufferedFile miso_file(base + "_miso" + extension);
+    SpiBufferedFile index_file(base + "_index" + extension);
+
+    U32 bytes_per_word = (mSettings->mBitsPerTransfer + 7) / 8;
+
+    //the enable assertion being written: frames of the same packet. The frames of the last assertion may not be in a packet yet.
+    bool assertion_open = false;
+    U64 assertion_packet = INVALID_RESULT_INDEX;
+    U64 assertion_starting_sample = 0;
+    U64 assertion_bytes = 0;
+    U64 repeat_starting_sample_index = 0;   //of the next repeat frame's transactions in mRepeatStartingSamples
+
+    U64 num_frames = GetNumFrames();
+    for (U64 i = 0; i < num_frames; i++) {
+        Frame frame = GetFrame(i);
+        U8 type = SPI_FRAME_TYPE(frame.mType);
+        if (((frame.mFlags & SPI_ERROR_FLAG) != 0) || ((type != SpiWordFrame) && (type != SpiTransactionFrame) && (type != SpiRepeatFrame))) {
+            continue;
+        }
+
+        //collapsed repeats: the words once for every transaction, each with its own index entry and starting sample
+        if (type == SpiRepeatFrame) {
+            if (assertion_open == true) {
+                index_file.AppendValue(assertion_starting_sample, 8);
+                index_file.AppendValue(assertion_bytes, 8);
+                assertion_open = false;
+            }
+
+            U64 offset = frame.mData1 * bytes_per_word;
+            U64 length = (frame.mData2 & 0xFFFFFFFF) * bytes_per_word;
+            U64 repeat_count = frame.mData2 >> 32;
+
+            std::lock_guard<std::mutex> lock(mPayloadMutex);
+            for (U64 j = 0; j < repeat_count; j++) {
+                mosi_file.Append(&mMosiPayload[offset], length);
+                miso_file.Append(&mMisoPayload[offset], length);
+                index_file.AppendValue(mRepeatStartingSamples[repeat_starting_sample_index + j], 8);
+                index_file.AppendValue(length, 8);
+            }
+            repeat_starting_sample_index += repeat_count;
+
+            if (UpdateExportProgressAndCheckForCancel(i, num_frames) == true) {
+                return;
+            }
+            continue;
+        }
+
+        U64 packet_id = GetPacketContainingFrameSequential(i);
+        if ((assertion_open == false) || (packet_id != assertion_packet)) {
+            if (assertion_open == true) {
+                index_file.AppendValue(assertion_starting_sample, 8);
+                index_file.AppendValue(assertion_bytes, 8);
+            }
+            assertion_open = true;
+            assertion_packet = packet_id;
+            assertion_starting_sample = frame.mStartingSampleInclusive;
+            assertion_bytes = 0;
+        }
+
+        if (type == SpiWordFrame) {
+            mosi_file.AppendValue(frame.mData1, bytes_per_word);
+            miso_file.AppendValue(frame.mData2, bytes_per_word);
+            assertion_bytes += bytes_per_word;
+        } else {    //straight from the payload buffers, which hold the words the same way
+            U64 offset = frame.mData1 * bytes_per_word;
+            U64 length = frame.mData2 * bytes_per_word;
+
+            std::lock_guard<std::mutex> lock(mPayloadMutex);
+            mosi_file.Append(&mMosiPayload[offset], length);
+            miso_file.Append(&mMisoPayload[offset], length);
+            assertion_bytes += length;
+        }
+
+        if (UpdateExportProgressAndCheckForCancel(i, num_frames) == true) {
+            return;
+        }
+    }
+
+    if (assertion_open == true) {
+        index_file.AppendValue(assertion_starting_sample, 8);
+        index_file.AppendValue(assertion_bytes, 8);
+    }
+
+    UpdateExportProgressAndCheckForCancel(num_frames, num_frames);
+}
+
+//Rebuilds the memory of each SPI NOR flash from the erase, program and read frames, like the decoder does to check the reads, and writes
+//it out from address 0 to the last sector anything is known about. Bytes nothing is known about are written as 0xFF, the erased state.
+//With one frame per transaction, the data bytes are the words of the transaction frame that follows the command.
+//With several slaves, every flash that was accessed gets its own file: name_1.bin, ...
+void SpiAnalyzerResults::GenerateFlashImageExportFile(const char *file)
+{
+    std::string base;
+    std::string extension;
+    SplitExportFileName(file, ".bin", base, extension);
+
+    SpiNorFlashImage images[SPI_MAX_SLAVES];
+    const SpiNorCommand *commands[SPI_MAX_SLAVES] = { NULL };
+    U64 addresses[SPI_MAX_SLAVES] = { 0 };
+    U64 data_indexes[SPI_MAX_SLAVES] = { 0 };
+    std::vector<U64> mosi_words;
+    std::vector<U64> miso_words;
+
+    U64 num_frames = GetNumFrames();
+    for (U64 i = 0; i < num_frames; i++) {
+        Frame frame = GetFrame(i);
+        U32 slave = SPI_FRAME_SLAVE(frame.mType);
+
+        if (SPI_FRAME_TYPE(frame.mType) == SpiCommandFrame) {
+            commands[slave] = GetNorCommand(frame);
+            data_indexes[slave] = 0;
+            if ((commands[slave] != NULL) && (commands[slave]->mAddressBytes == 0)) {  //chip erases have no address phase
+                images[slave].AddErase(commands[slave], 0);
+            }
+        } else if (SPI_FRAME_TYPE(frame.mType) == SpiAddressFrame) {
+            addresses[slave] = frame.mData1;
+            images[slave].AddErase(commands[slave], addresses[slave]);
+        } else if (SPI_FRAME_TYPE(frame.mType) == SpiDataFrame) {
+            U8 expected;
+            images[slave].AddData(GetNorCommand(frame), addresses[slave], U32(frame.mData2), U8(frame.mData1), expected);
+        } else if ((SPI_FRAME_TYPE(frame.mType) == SpiTransactionFrame) && (commands[slave] != NULL)) {
+            GetPayloadWords(frame.mData1, frame.mData2, mosi_words, miso_words);
+            const std::vector<U64> &data = (commands[slave]->mDataFromFlash == true) ? miso_words : mosi_words;
+            for (U64 j = 0; j < data.size(); j++) {
+                U8 expected;
+                images[slave].AddData(commands[slave], addresses[slave], data_indexes[slave], U8(data[j]), expected);
+                data_indexes[slave]++;
+            }
+        }
+
+        if (UpdateExportProgressAndCheckForCancel(i, num_frames) == true) {
+            return;
+        }
+    }
+
+    bool multi_slave = mSettings->IsMultiSlave();
+    std::vector<U8> sector(SPI_NOR_IMAGE_SECTOR_SIZE);
+    U32 slaves = (multi_slave == true) ? SPI_MAX_SLAVES : 1;
+    for (U32 slave = 0; slave < slaves; slave++) {
+        U64 size = images[slave].GetSize();
+        if ((multi_slave == true) && (size == 0)) {
+            continue;
+        }
+
+        std::stringstream ss;
+        ss << base;
+        if (multi_slave == true) {
+            ss << "_" << slave + 1;
+        }
+        ss << extension;
+
+        SpiBufferedFile image_file(ss.str());
+        for (U64 address = 0; address < size; address += SPI_NOR_IMAGE_SECTOR_SIZE) {
+            images[slave].GetSector(address, &sector[0]);
+            image_file.Append(&sector[0], SPI_NOR_IMAGE_SECTOR_SIZE);
+        }
+    }
+
+    UpdateExportProgressAndCheckForCancel(num_frames, num_frames);
+}
+
+//the export file name without its extension, and the extension with its dot (default_extension if it has none)
+void SpiAnalyzerResults::SplitExportFileName(const char *file, const char *default_extension, std::string &base, std::string &extension)
+{
+    base = file;
+    extension = default_extension;
+
+    size_t dot = base.find_last_of('.');
+    size_t separator = base.find_last_of("/\\");
+    if ((dot != std::string::npos) && ((separator == std::string::npos) || (dot > separator))) {
+        extension = base.substr(dot);
+        base.erase(dot);
+    }
+}
@@ -2,8 +2,56 @@
 #define SPI_ANALYZER_RESULTS
 
 #include <AnalyzerResults.h>
+#include <vector>
+#include <mutex>
+#include "SpiNorFlash.h"
+#include "SpiSdCard.h"
+#include "SpiDisplay.h"
 
 #define SPI_ERROR_FLAG ( 1 << 0 )
+#define SPI_SD_CHECK_ERROR_FLAG ( 1 << 1 )  //SD card frames: CRC mismatch, error bits in a response, or a rejected block
+#define SPI_SD_INCOMPLETE_FLAG ( 1 << 2 )   //SD card data blocks: stopped before the CRC
+#define SPI_NOR_MISMATCH_FLAG ( 1 << 3 )    //SPI NOR data frames, and transaction frames holding a data phase: a read byte that differs from what was programmed
+
+//word frames hold the MOSI/MISO words in mData1/mData2.
+//transaction frames hold the index of their first word in the payload buffers in mData1, and the number of words in mData2.
+//command frames hold the command in mData1 and its length in bytes in mData2 (2 in octal DTR mode: the opcode, then its extension).
+//address frames hold the address in mData1 and its length in mData2, dummy frames the clock count in mData2.
+//SPI NOR data frames hold the byte on the driven side in mData1, and the opcode << 32 | the byte's index in the data phase in mData2.
+//  read bytes that don't match the flash image also have the byte the image holds << 40 in mData2.
+//SD card frames hold the command index (+ SPI_SD_APP_COMMAND for ACMDs) in the low byte of mData2, and:
+//  command frames the argument in mData1, and the CRC byte << 8 in mData2;
+//  response frames the response bytes in mData1, R1 the most significant, and their number << 8 in mData2;
+//  data block frames the index of their first byte in the payload buffers in mData1, and the byte count << 8 | the CRC16 << 32 in mData2;
+//  token frames (data response, data error and stop transmission tokens) the token in mData1.
+//display controller frames:
+//  command frames hold the opcode in mData1;
+//  parameter frames up to 8 parameters in mData1, the first the most significant, and the opcode | their number << 8 | the index of the first << 32 in mData2;
+//  pixel data frames the index of their first byte in the payload buffers in mData1, and mData2 like parameter frames.
+//repeat frames stand for a run of transactions identical to the one before them. They hold the index of that transaction's words
+//in the payload buffers in mData1, and the word count | the number of repeats << 32 in mData2. The starting sample of every
+//repeated transaction is kept in the results, in the order of the repeat frames.
+//line word frames hold one word of every independent data line. mData2 is the mask of the lines used, and mData1 the index in the payload
+//buffers of a word per line pair, up to the highest line used: word n holds line 2n on the MOSI side and line 2n + 1 on the MISO side
+//(MOSI and MISO are lines 0 and 1).
+enum SpiFrameType { SpiWordFrame, SpiTransactionFrame, SpiCommandFrame, SpiAddressFrame, SpiDummyFrame, SpiDataFrame, SpiSdCommandFrame, SpiSdResponseFrame, SpiSdBlockFrame, SpiSdTokenFrame,
+                    SpiDisplayCommandFrame, SpiDisplayParameterFrame, SpiDisplayPixelFrame, SpiRepeatFrame, SpiLineWordsFrame };
+
+//mType holds the SpiFrameType in the low nibble, and the slave (index of its enable line) in the high nibble
+#define SPI_FRAME_TYPE( type ) ( ( type ) & 0x0F )
+#define SPI_FRAME_SLAVE( type ) ( ( type ) >> 4 )
+#define SPI_FRAME_TYPE_FOR_SLAVE( type, slave ) ( U8( ( ( slave ) << 4 ) | ( type ) ) )
+
+enum SpiTimingMeasurement { SpiClockPeriod, SpiEnableSetup, SpiEnableHold, SpiWordGap, SpiTimingMeasurementCount };
+
+//running histogram of one timing measurement, in samples. bin n counts the values from 2^n up to 2^(n+1) (bin 0 also counts 0).
+struct SpiTimingHistogram {
+    U64 mCount;
+    U64 mMinimum;
+    U64 mMaximum;
+    U64 mTotal;
+    U64 mBins[64];
+};
 
 class SpiAnalyzer;
 class SpiAnalyzerSettings;
@@ -21,11 +69,49 @@ public:
     virtual void GeneratePacketTabularText(U64 packet_id, DisplayBase display_base);
     virtual void GenerateTransactionTabularText(U64 transaction_id, DisplayBase display_base);
 
+    U64 GetPayloadWordCount();
+    void AddPayloadWord(U64 mosi_word, U64 miso_word);
+    void GetPayloadWords(U64 first_word, U64 count, std::vector<U64> &mosi_words, std::vector<U64> &miso_words);
+    void RemovePayloadWords(U64 first_word);
+    void AddRepeatStartingSamples(const std::vector<U64> &samples);
+    void UpdateTimingStatistics(const SpiTimingHistogram *histograms);
+
 protected: //functions
+    std::string GetPhaseFrameText(const Frame &frame, DisplayBase display_base);
+    void AddPhaseResultStrings(const Frame &frame, DisplayBase display_base);
+    Channel GetPhaseFrameChannel(const Frame &frame);
+    const SpiNorCommand *GetNorCommand(const Frame &frame);
+    std::string GetNorDataLabel(const Frame &frame);
+    bool IsSdFrame(const Frame &frame);
+    std::string GetSdFrameText(const Frame &frame, DisplayBase display_base);
+    std::string GetSdCommandLabel(U8 key);
+    bool IsDisplayFrame(const Frame &frame);
+    std::string GetDisplayFrameText(const Frame &frame, DisplayBase display_base);
+    std::string GetDisplayCommandLabel(U8 opcode, DisplayBase display_base);
+    std::string GetPayloadText(U64 first_word, U64 word_count, bool miso, DisplayBase display_base, U64 max_words);
+    std::string GetRepeatText(const Frame &frame, bool miso, DisplayBase display_base, U64 max_words);
+    U64 GetLineWord(const Frame &frame, U32 line);
+    std::string GetLineName(U32 line);
+    void GenerateTimingExportFile(const char *file);
+    void GenerateDisplayExportFile(const char *file);
+    void GenerateBinaryExportFile(const char *file);
+    void GenerateFlashImageExportFile(const char *file);
+    void SplitExportFileName(const char *file, const char *default_extension, std::string &base, std::string &extension);
 
 protected: //vars
     SpiAnalyzerSettings *mSettings;
     SpiAnalyzer *mAnalyzer;
+
+    //payload of the transaction frames, (mBitsPerTransfer + 7) / 8 bytes per word, least significant byte first.
+    //written by the worker thread, read by the GUI and export threads.
+    std::vector<U8> mMosiPayload;
+    std::vector<U8> mMisoPayload;
+    std::vector<U64> mRepeatStartingSamples;    //where every transaction of every repeat frame started, in frame order
+    std::mutex mPayloadMutex;
+
+    //written by the worker thread at the end of every transaction, read by the export thread.
+    SpiTimingHistogram mTimingHistograms[SpiTimingMeasurementCount];
+    std::mutex mTimingMutex;
 };
 
 #endif //SPI_ANALYZER_RESULTS
@@ -9,12 +9,29 @@ SpiAnalyzerSettings::SpiAnalyzerSettings()
         mMisoChannel(UNDEFINED_CHANNEL),
         mClockChannel(UNDEFINED_CHANNEL),
         mEnableChannel(UNDEFINED_CHANNEL),
+        mIo2Channel(UNDEFINED_CHANNEL),
+        mIo3Channel(UNDEFINED_CHANNEL),
+        mDqsChannel(UNDEFINED_CHANNEL),
         mShiftOrder(AnalyzerEnums::MsbFirst),
         mBitsPerTransfer(8),
         mClockInactiveState(BIT_HIGH),
         mDataValidEdge(AnalyzerEnums::TrailingEdge),
         mEnableActiveState(BIT_LOW),
-        mShowMarker(BIT_HIGH)
+        mShowMarker(BIT_HIGH),
+        mFrameGranularity(SpiAnalyzerEnums::FramePerWord),
+        mLaneMode(SpiAnalyzerEnums::SingleLane),
+        mAddressBytes(3),
+        mDummyCycles(0),
+        mNorCommands(false),
+        mClockIdleTimeout(0),
+        mSdCard(false),
+        mDisplay(false),
+        mDcChannel(UNDEFINED_CHANNEL),
+        mDisplayWidth(240),
+        mDisplayHeight(320),
+        mCollapseRepeats(false),
+        mAutoDetect(false),
+        mIndependentLines(false)
 {
     mMosiChannelInterface.reset(new AnalyzerSettingInterfaceChannel());
     mMosiChannelInterface->SetTitleAndTooltip("MOSI", "Master Out, Slave In");
@@ -35,6 +52,43 @@ SpiAnalyzerSettings::SpiAnalyzerSettings()
     mEnableChannelInterface->SetChannel(mEnableChannel);
     mEnableChannelInterface->SetSelectionOfNoneIsAllowed(true);
 
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        std::stringstream ss;
+        ss << "Enable " << i + 2;
+
+        mSlaveEnableChannels[i] = UNDEFINED_CHANNEL;
+        mSlaveEnableChannelInterfaces[i].reset(new AnalyzerSettingInterfaceChannel());
+        mSlaveEnableChannelInterfaces[i]->SetTitleAndTooltip(ss.str().c_str(), "Enable line of another slave on the same clock and data lines, decoded in the same pass");
+        mSlaveEnableChannelInterfaces[i]->SetChannel(mSlaveEnableChannels[i]);
+        mSlaveEnableChannelInterfaces[i]->SetSelectionOfNoneIsAllowed(true);
+    }
+
+    mIo2ChannelInterface.reset(new AnalyzerSettingInterfaceChannel());
+    mIo2ChannelInterface->SetTitleAndTooltip("IO2", "Quad and octal SPI only: IO2 (WP#). MOSI is IO0 and MISO is IO1 in dual, quad and octal modes. Also a data line of its own when decoding independent data lines");
+    mIo2ChannelInterface->SetChannel(mIo2Channel);
+    mIo2ChannelInterface->SetSelectionOfNoneIsAllowed(true);
+
+    mIo3ChannelInterface.reset(new AnalyzerSettingInterfaceChannel());
+    mIo3ChannelInterface->SetTitleAndTooltip("IO3", "Quad and octal SPI only: IO3 (HOLD#/RESET#). Also a data line of its own when decoding independent data lines");
+    mIo3ChannelInterface->SetChannel(mIo3Channel);
+    mIo3ChannelInterface->SetSelectionOfNoneIsAllowed(true);
+
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        std::stringstream ss;
+        ss << "IO" << i + 4;
+
+        mOctalIoChannels[i] = UNDEFINED_CHANNEL;
+        mOctalIoChannelInterfaces[i].reset(new AnalyzerSettingInterfaceChannel());
+        mOctalIoChannelInterfaces[i]->SetTitleAndTooltip(ss.str().c_str(), "Octal SPI, or a data line of its own when decoding independent data lines");
+        mOctalIoChannelInterfaces[i]->SetChannel(mOctalIoChannels[i]);
+        mOctalIoChannelInterfaces[i]->SetSelectionOfNoneIsAllowed(true);
+    }
+
+    mDqsChannelInterface.reset(new AnalyzerSettingInterfaceChannel());
+    mDqsChannelInterface->SetTitleAndTooltip("DQS", "Octal DTR only: data strobe. Data the flash drives is sampled in the middle of each half period of DQS instead of at the SCK edges");
+    mDqsChannelInterface->SetChannel(mDqsChannel);
+    mDqsChannelInterface->SetSelectionOfNoneIsAllowed(true);
+
     mShiftOrderInterface.reset(new AnalyzerSettingInterfaceNumberList());
     mShiftOrderInterface->SetTitleAndTooltip("", "");
     mShiftOrderInterface->AddNumber(AnalyzerEnums::MsbFirst, "Most Significant Bit First (Standard)", "");
@@ -80,27 +134,157 @@ SpiAnalyzerSettings::SpiAnalyzerSettings()
     mEnableActiveStateInterface->AddNumber(BIT_HIGH, "Enable line is Active High", "");
     mEnableActiveStateInterface->SetNumber(mEnableActiveState);
 
+    mFrameGranularityInterface.reset(new AnalyzerSettingInterfaceNumberList());
+    mFrameGranularityInterface->SetTitleAndTooltip("", "Specify if every word gets its own frame, or every enable assertion is shown as one frame");
+    mFrameGranularityInterface->AddNumber(SpiAnalyzerEnums::FramePerWord, "One Frame per Word (Standard)", "");
+    mFrameGranularityInterface->AddNumber(SpiAnalyzerEnums::FramePerTransaction, "One Frame per Transaction", "All words of an enable assertion in one frame; best for bulk transfers");
+    mFrameGranularityInterface->SetNumber(mFrameGranularity);
+
+    mLaneModeInterface.reset(new AnalyzerSettingInterfaceNumberList());
+    mLaneModeInterface->SetTitleAndTooltip("", "Specify how many data lines the command, address and data phases of each transaction use");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::SingleLane, "Standard SPI (MOSI/MISO)", "");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Dual112, "Dual SPI 1-1-2", "Command and address on IO0, data on IO0-IO1");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Dual122, "Dual SPI 1-2-2", "Command on IO0, address and data on IO0-IO1");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Quad114, "Quad SPI 1-1-4", "Command and address on IO0, data on IO0-IO3");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Quad144, "Quad SPI 1-4-4", "Command on IO0, address and data on IO0-IO3");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Quad444, "Quad SPI 4-4-4 (QPI)", "Command, address and data on IO0-IO3");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Octal118, "Octal SPI 1S-1S-8S", "Command and address on IO0, data on IO0-IO7");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Octal188, "Octal SPI 1S-8S-8S", "Command on IO0, address and data on IO0-IO7");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Octal888, "Octal SPI 8S-8S-8S", "Command, address and data on IO0-IO7");
+    mLaneModeInterface->AddNumber(SpiAnalyzerEnums::Octal888Dtr, "Octal DTR 8D-8D-8D (xSPI)", "Command, address and data on IO0-IO7, on both clock edges; 2 byte commands, 4 byte addresses");
+    mLaneModeInterface->SetNumber(mLaneMode);
+
+    mAddressBytesInterface.reset(new AnalyzerSettingInterfaceNumberList());
+    mAddressBytesInterface->SetTitleAndTooltip("", "Dual/quad modes: length of the address phase. SPI NOR flash decoding: 3 or 4 byte addressing for the commands that don't fix it");
+    mAddressBytesInterface->AddNumber(0, "No Address Phase", "");
+    mAddressBytesInterface->AddNumber(3, "3 Address Bytes", "");
+    mAddressBytesInterface->AddNumber(4, "4 Address Bytes", "");
+    mAddressBytesInterface->SetNumber(mAddressBytes);
+
+    mDummyCyclesInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mDummyCyclesInterface->SetTitleAndTooltip("Dummy Cycles", "Dual/quad modes: clocks between the address and data phases, mode bits included. SPI NOR flash decoding takes them from the opcode");
+    mDummyCyclesInterface->SetMax(64);
+    mDummyCyclesInterface->SetMin(0);
+    mDummyCyclesInterface->SetInteger(mDummyCycles);
+
+    mNorCommandsInterface.reset(new AnalyzerSettingInterfaceBool());
+    mNorCommandsInterface->SetTitleAndTooltip("", "Split every transaction into the command, address, dummy and data phases of its SPI NOR flash opcode");
+    mNorCommandsInterface->SetCheckBoxText("Decode SPI NOR Flash Commands");
+    mNorCommandsInterface->SetValue(mNorCommands);
+
+    mClockIdleTimeoutInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mClockIdleTimeoutInterface->SetTitleAndTooltip("Clock Idle Timeout (us)", "Without an Enable line: start a new transaction and packet when the clock has been idle this long. 0 to turn off");
+    mClockIdleTimeoutInterface->SetMax(1000000);
+    mClockIdleTimeoutInterface->SetMin(0);
+    mClockIdleTimeoutInterface->SetInteger(mClockIdleTimeout);
+
+    mSdCardInterface.reset(new AnalyzerSettingInterfaceBool());
+    mSdCardInterface->SetTitleAndTooltip("", "Show the commands, responses and data blocks of an SD card in SPI mode, with their CRCs checked, instead of single bytes");
+    mSdCardInterface->SetCheckBoxText("Decode SD Card Commands (SPI Mode)");
+    mSdCardInterface->SetValue(mSdCard);
+
+    mDisplayInterface.reset(new AnalyzerSettingInterfaceBool());
+    mDisplayInterface->SetTitleAndTooltip("", "Show the commands, parameters and pixel data of an ST7789, ILI9341 or similar display controller instead of single bytes. The PPM export rebuilds the frames it draws");
+    mDisplayInterface->SetCheckBoxText("Decode Display Controller Commands");
+    mDisplayInterface->SetValue(mDisplay);
+
+    mDcChannelInterface.reset(new AnalyzerSettingInterfaceChannel());
+    mDcChannelInterface->SetTitleAndTooltip("D/C", "Display decoding only: data/command select (D/CX), low for commands. None for 3-wire panels, which send it as the first of 9 bits");
+    mDcChannelInterface->SetChannel(mDcChannel);
+    mDcChannelInterface->SetSelectionOfNoneIsAllowed(true);
+
+    mDisplayWidthInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mDisplayWidthInterface->SetTitleAndTooltip("Display Width", "Display decoding: columns of the frame memory, without MADCTL row/column exchange");
+    mDisplayWidthInterface->SetMax(4096);
+    mDisplayWidthInterface->SetMin(1);
+    mDisplayWidthInterface->SetInteger(mDisplayWidth);
+
+    mDisplayHeightInterface.reset(new AnalyzerSettingInterfaceInteger());
+    mDisplayHeightInterface->SetTitleAndTooltip("Display Height", "Display decoding: rows of the frame memory, without MADCTL row/column exchange");
+    mDisplayHeightInterface->SetMax(4096);
+    mDisplayHeightInterface->SetMin(1);
+    mDisplayHeightInterface->SetInteger(mDisplayHeight);
+
+    mCollapseRepeatsInterface.reset(new AnalyzerSettingInterfaceBool());
+    mCollapseRepeatsInterface->SetTitleAndTooltip("", "Show a run of identical transactions, such as a driver polling a status register, as the first one and a single frame with the repeat count");
+    mCollapseRepeatsInterface->SetCheckBoxText("Collapse Repeated Transactions");
+    mCollapseRepeatsInterface->SetValue(mCollapseRepeats);
+
+    mAutoDetectInterface.reset(new AnalyzerSettingInterfaceBool());
+    mAutoDetectInterface->SetTitleAndTooltip("", "Check the clock polarity, data valid edge and bits per transfer against the first transactions, and decode again with the ones they show if they don't fit");
+    mAutoDetectInterface->SetCheckBoxText("Detect Clock Mode and Word Size");
+    mAutoDetectInterface->SetValue(mAutoDetect);
+
+    mIndependentLinesInterface.reset(new AnalyzerSettingInterfaceBool());
+    mIndependentLinesInterface->SetTitleAndTooltip("", "Decode MOSI, MISO and IO2-IO7 as separate data lines sharing the clock and enable, such as the converters of a multi-channel ADC, each with its own word per frame");
+    mIndependentLinesInterface->SetCheckBoxText("Decode Independent Data Lines");
+    mIndependentLinesInterface->SetValue(mIndependentLines);
 
     AddInterface(mMosiChannelInterface.get());
     AddInterface(mMisoChannelInterface.get());
     AddInterface(mClockChannelInterface.get());
     AddInterface(mEnableChannelInterface.get());
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        AddInterface(mSlaveEnableChannelInterfaces[i].get());
+    }
+    AddInterface(mIo2ChannelInterface.get());
+    AddInterface(mIo3ChannelInterface.get());
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        AddInterface(mOctalIoChannelInterfaces[i].get());
+    }
+    AddInterface(mDqsChannelInterface.get());
+    AddInterface(mDcChannelInterface.get());
     AddInterface(mShiftOrderInterface.get());
     AddInterface(mBitsPerTransferInterface.get());
     AddInterface(mClockInactiveStateInterface.get());
     AddInterface(mDataValidEdgeInterface.get());
     AddInterface(mEnableActiveStateInterface.get());
     AddInterface(mUseShowMarkerInterface.get());
+    AddInterface(mFrameGranularityInterface.get());
+    AddInterface(mLaneModeInterface.get());
+    AddInterface(mAddressBytesInterface.get());
+    AddInterface(mDummyCyclesInterface.get());
+    AddInterface(mNorCommandsInterface.get());
+    AddInterface(mClockIdleTimeoutInterface.get());
+    AddInterface(mSdCardInterface.get());
+    AddInterface(mDisplayInterface.get());
+    AddInterface(mDisplayWidthInterface.get());
+    AddInterface(mDisplayHeightInterface.get());
+    AddInterface(mCollapseRepeatsInterface.get());
+    AddInterface(mAutoDetectInterface.get());
+    AddInterface(mIndependentLinesInterface.get());
 
     AddExportOption(0, "Export as text/csv file");
     AddExportExtension(0, "Text file", "txt");
     AddExportExtension(0, "CSV file", "csv");
 
+    AddExportOption(1, "Export timing statistics as csv file");
+    AddExportExtension(1, "CSV file", "csv");
+
+    AddExportOption(2, "Export display frames as PPM images");
+    AddExportExtension(2, "PPM image", "ppm");
+
+    AddExportOption(3, "Export MOSI and MISO words as binary files");
+    AddExportExtension(3, "Binary file", "bin");
+
+    AddExportOption(4, "Export SPI NOR flash image as binary file");
+    AddExportExtension(4, "Binary file", "bin");
+
     ClearChannels();
     AddChannel(mMosiChannel, "MOSI", false);
     AddChannel(mMisoChannel, "MISO", false);
     AddChannel(mClockChannel, "CLOCK", false);
     AddChannel(mEnableChannel, "ENABLE", false);
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        AddChannel(mSlaveEnableChannels[i], mSlaveEnableChannelInterfaces[i]->GetTitle(), false);
+    }
+    AddChannel(mIo2Channel, "IO2", false);
+    AddChannel(mIo3Channel, "IO3", false);
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        AddChannel(mOctalIoChannels[i], mOctalIoChannelInterfaces[i]->GetTitle(), false);
+    }
+    AddChannel(mDqsChannel, "DQS", false);
+    AddChannel(mDcChannel, "D/C", false);
 }
 
 SpiAnalyzerSettings::~SpiAnalyzerSettings()
@@ -113,12 +297,36 @@ bool SpiAnalyzerSettings::SetSettingsFromInterfaces()
     Channel miso = mMisoChannelInterface->GetChannel();
     Channel clock = mClockChannelInterface->GetChannel();
     Channel enable = mEnableChannelInterface->GetChannel();
+    Channel io2 = mIo2ChannelInterface->GetChannel();
+    Channel io3 = mIo3ChannelInterface->GetChannel();
 
     std::vector<Channel> channels;
     channels.push_back(mosi);
     channels.push_back(miso);
     channels.push_back(clock);
     channels.push_back(enable);
+    channels.push_back(io2);
+    channels.push_back(io3);
+
+    bool octal_io_set = true;
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        channels.push_back(mOctalIoChannelInterfaces[i]->GetChannel());
+        if (channels.back() == UNDEFINED_CHANNEL) {
+            octal_io_set = false;
+        }
+    }
+    Channel dqs = mDqsChannelInterface->GetChannel();
+    channels.push_back(dqs);
+    Channel dc = mDcChannelInterface->GetChannel();
+    channels.push_back(dc);
+
+    bool multi_slave = false;
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        channels.push_back(mSlaveEnableChannelInterfaces[i]->GetChannel());
+        if (channels.back() != UNDEFINED_CHANNEL) {
+            multi_slave = true;
+        }
+    }
 
     if (AnalyzerHelpers::DoChannelsOverlap(&channels[0], channels.size()) == true) {
         SetErrorText("Please select different channels for each input.");
@@ -130,10 +338,144 @@ bool SpiAnalyzerSettings::SetSettingsFromInterfaces()
         return false;
     }
 
+    if ((multi_slave == true) && (enable == UNDEFINED_CHANNEL)) {
+        SetErrorText("Please select the Enable channel before the enable lines of more slaves.");
+        return false;
+    }
+
+    SpiAnalyzerEnums::LaneMode lane_mode = SpiAnalyzerEnums::LaneMode(U32(mLaneModeInterface->GetNumber()));
+    bool nor_commands = mNorCommandsInterface->GetValue();
+    if ((lane_mode != SpiAnalyzerEnums::SingleLane) || (nor_commands == true)) {
+        if ((mosi == UNDEFINED_CHANNEL) || (miso == UNDEFINED_CHANNEL) || (enable == UNDEFINED_CHANNEL)) {
+            SetErrorText("Dual, quad and octal modes and SPI NOR flash decoding need MOSI (IO0), MISO (IO1) and Enable.");
+            return false;
+        }
+        if ((lane_mode >= SpiAnalyzerEnums::Quad114) && ((io2 == UNDEFINED_CHANNEL) || (io3 == UNDEFINED_CHANNEL))) {
+            SetErrorText("Quad and octal modes need IO2 and IO3.");
+            return false;
+        }
+        if ((lane_mode >= SpiAnalyzerEnums::Octal118) && (octal_io_set == false)) {
+            SetErrorText("Octal modes need IO4 to IO7.");
+            return false;
+        }
+        if ((lane_mode == SpiAnalyzerEnums::Octal888Dtr) && (U32(mAddressBytesInterface->GetNumber()) == 3)) {
+            SetErrorText("Octal DTR mode transfers 2 bytes per clock, so it needs 4 address bytes or none.");
+            return false;
+        }
+        if ((U32(mBitsPerTransferInterface->GetNumber()) != 8) || (AnalyzerEnums::ShiftOrder(U32(mShiftOrderInterface->GetNumber())) != AnalyzerEnums::MsbFirst)) {
+            SetErrorText("Dual, quad and octal modes and SPI NOR flash decoding transfer 8 bit words, most significant bit first.");
+            return false;
+        }
+    }
+
+    if ((dqs != UNDEFINED_CHANNEL) && (lane_mode != SpiAnalyzerEnums::Octal888Dtr)) {
+        SetErrorText("DQS is only used in octal DTR mode.");
+        return false;
+    }
+
+    bool sd_card = mSdCardInterface->GetValue();
+    if (sd_card == true) {
+        if ((lane_mode != SpiAnalyzerEnums::SingleLane) || (nor_commands == true)) {
+            SetErrorText("SD card decoding can't be combined with dual, quad and octal modes or SPI NOR flash decoding.");
+            return false;
+        }
+        if ((mosi == UNDEFINED_CHANNEL) || (miso == UNDEFINED_CHANNEL)) {
+            SetErrorText("SD card decoding needs MOSI and MISO.");
+            return false;
+        }
+        if ((U32(mBitsPerTransferInterface->GetNumber()) != 8) || (AnalyzerEnums::ShiftOrder(U32(mShiftOrderInterface->GetNumber())) != AnalyzerEnums::MsbFirst)) {
+            SetErrorText("SD cards transfer 8 bit words, most significant bit first.");
+            return false;
+        }
+    }
+
+    bool display = mDisplayInterface->GetValue();
+    if (display == true) {
+        if ((lane_mode != SpiAnalyzerEnums::SingleLane) || (nor_commands == true) || (sd_card == true)) {
+            SetErrorText("Display decoding can't be combined with dual, quad and octal modes, SPI NOR flash or SD card decoding.");
+            return false;
+        }
+        if (mosi == UNDEFINED_CHANNEL) {
+            SetErrorText("Display decoding needs MOSI.");
+            return false;
+        }
+        U32 bits = (dc != UNDEFINED_CHANNEL) ? 8 : 9;
+        if ((U32(mBitsPerTransferInterface->GetNumber()) != bits) || (AnalyzerEnums::ShiftOrder(U32(mShiftOrderInterface->GetNumber())) != AnalyzerEnums::MsbFirst)) {
+            SetErrorText("Display controllers transfer 8 bit words with a D/C line, or 9 bit words without (3-wire), most significant bit first.");
+            return false;
+        }
+    } else if (dc != UNDEFINED_CHANNEL) {
+        SetErrorText("D/C is only used for display decoding.");
+        return false;
+    }
+
+    bool collapse_repeats = mCollapseRepeatsInterface->GetValue();
+    if (collapse_repeats == true) {
+        if (enable == UNDEFINED_CHANNEL) {
+            SetErrorText("Collapsing repeated transactions needs the Enable channel.");
+            return false;
+        }
+        if ((sd_card == true) || (display == true)) {
+            SetErrorText("Repeated transactions can't be collapsed with SD card or display decoding.");
+            return false;
+        }
+    }
+
+    bool auto_detect = mAutoDetectInterface->GetValue();
+    if (auto_detect == true) {
+        if (enable == UNDEFINED_CHANNEL) {
+            SetErrorText("Detecting the clock mode and word size needs the Enable channel.");
+            return false;
+        }
+        if ((lane_mode != SpiAnalyzerEnums::SingleLane) || (nor_commands == true) || (sd_card == true) || (display == true)) {
+            SetErrorText("The clock mode and word size can only be detected for standard SPI words.");
+            return false;
+        }
+    }
+
+    bool independent_lines = mIndependentLinesInterface->GetValue();
+    if (independent_lines == true) {
+        if ((lane_mode != SpiAnalyzerEnums::SingleLane) || (nor_commands == true) || (sd_card == true) || (display == true)) {
+            SetErrorText("Independent data lines can't be combined with dual, quad and octal modes, SPI NOR flash, SD card or display decoding.");
+            return false;
+        }
+        if ((collapse_repeats == true) || (auto_detect == true)) {
+            SetErrorText("Independent data lines can't be combined with collapsing repeated transactions or detecting the clock mode.");
+            return false;
+        }
+        if (SpiAnalyzerEnums::FrameGranularity(U32(mFrameGranularityInterface->GetNumber())) != SpiAnalyzerEnums::FramePerWord) {
+            SetErrorText("Independent data lines are decoded one frame per word.");
+            return false;
+        }
+        Channel lines[SPI_MAX_LANES] = { mosi, miso, io2, io3 };
+        U32 line_count = 0;
+        for (U32 i = 0; i < SPI_MAX_LANES; i++) {
+            if (i >= 4) {
+                lines[i] = mOctalIoChannelInterfaces[i - 4]->GetChannel();
+            }
+            if (lines[i] != UNDEFINED_CHANNEL) {
+                line_count++;
+            }
+        }
+        if (line_count < 2) {
+            SetErrorText("Please select at least two data lines among MOSI, MISO and IO2 to IO7 to decode them independently.");
+            return false;
+        }
+    }
+
     mMosiChannel = mMosiChannelInterface->GetChannel();
     mMisoChannel = mMisoChannelInterface->GetChannel();
     mClockChannel = mClockChannelInterface->GetChannel();
     mEnableChannel = mEnableChannelInterface->GetChannel();
+    mIo2Channel = mIo2ChannelInterface->GetChannel();
+    mIo3Channel = mIo3ChannelInterface->GetChannel();
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        mOctalIoChannels[i] = mOctalIoChannelInterfaces[i]->GetChannel();
+    }
+    mDqsChannel = dqs;
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        mSlaveEnableChannels[i] = mSlaveEnableChannelInterfaces[i]->GetChannel();
+    }
 
     mShiftOrder = (AnalyzerEnums::ShiftOrder) U32(mShiftOrderInterface->GetNumber());
     mBitsPerTransfer =      U32(mBitsPerTransferInterface->GetNumber());
@@ -142,12 +484,36 @@ bool SpiAnalyzerSettings::SetSettingsFromInterfaces()
     mEnableActiveState = (BitState) U32(mEnableActiveStateInterface->GetNumber());
 
     mShowMarker = mUseShowMarkerInterface->GetValue();
+    mFrameGranularity = SpiAnalyzerEnums::FrameGranularity(U32(mFrameGranularityInterface->GetNumber()));
+    mLaneMode = lane_mode;
+    mAddressBytes = U32(mAddressBytesInterface->GetNumber());
+    mDummyCycles = mDummyCyclesInterface->GetInteger();
+    mNorCommands = nor_commands;
+    mClockIdleTimeout = mClockIdleTimeoutInterface->GetInteger();
+    mSdCard = sd_card;
+    mDisplay = display;
+    mDcChannel = dc;
+    mDisplayWidth = mDisplayWidthInterface->GetInteger();
+    mDisplayHeight = mDisplayHeightInterface->GetInteger();
+    mCollapseRepeats = collapse_repeats;
+    mAutoDetect = auto_detect;
+    mIndependentLines = independent_lines;
 
     ClearChannels();
     AddChannel(mMosiChannel, "MOSI", mMosiChannel != UNDEFINED_CHANNEL);
     AddChannel(mMisoChannel, "MISO", mMisoChannel != UNDEFINED_CHANNEL);
     AddChannel(mClockChannel, "CLOCK", mClockChannel != UNDEFINED_CHANNEL);
     AddChannel(mEnableChannel, "ENABLE", mEnableChannel != UNDEFINED_CHANNEL);
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        AddChannel(mSlaveEnableChannels[i], mSlaveEnableChannelInterfaces[i]->GetTitle(), mSlaveEnableChannels[i] != UNDEFINED_CHANNEL);
+    }
+    AddChannel(mIo2Channel, "IO2", mIo2Channel != UNDEFINED_CHANNEL);
+    AddChannel(mIo3Channel, "IO3", mIo3Channel != UNDEFINED_CHANNEL);
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        AddChannel(mOctalIoChannels[i], mOctalIoChannelInterfaces[i]->GetTitle(), mOctalIoChannels[i] != UNDEFINED_CHANNEL);
+    }
+    AddChannel(mDqsChannel, "DQS", mDqsChannel != UNDEFINED_CHANNEL);
+    AddChannel(mDcChannel, "D/C", mDcChannel != UNDEFINED_CHANNEL);
 
     return true;
 }
@@ -178,11 +544,99 @@ void SpiAnalyzerSettings::LoadSettings(const char *settings)
         mShowMarker = show_marker;
     }
 
+    U32 frame_granularity;
+    if (text_archive >> frame_granularity) {
+        mFrameGranularity = SpiAnalyzerEnums::FrameGranularity(frame_granularity);
+    }
+
+    Channel io2_channel;
+    Channel io3_channel;
+    U32 lane_mode;
+    U32 address_bytes;
+    U32 dummy_cycles;
+    if ((text_archive >> io2_channel) && (text_archive >> io3_channel) && (text_archive >> lane_mode) && (text_archive >> address_bytes) && (text_archive >> dummy_cycles)) {
+        mIo2Channel = io2_channel;
+        mIo3Channel = io3_channel;
+        mLaneMode = SpiAnalyzerEnums::LaneMode(lane_mode);
+        mAddressBytes = address_bytes;
+        mDummyCycles = dummy_cycles;
+    }
+
+    bool nor_commands;
+    if (text_archive >> nor_commands) {
+        mNorCommands = nor_commands;
+    }
+
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        Channel slave_enable_channel;
+        if (text_archive >> slave_enable_channel) {
+            mSlaveEnableChannels[i] = slave_enable_channel;
+        }
+    }
+
+    U32 clock_idle_timeout;
+    if (text_archive >> clock_idle_timeout) {
+        mClockIdleTimeout = clock_idle_timeout;
+    }
+
+    bool sd_card;
+    if (text_archive >> sd_card) {
+        mSdCard = sd_card;
+    }
+
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        Channel octal_io_channel;
+        if (text_archive >> octal_io_channel) {
+            mOctalIoChannels[i] = octal_io_channel;
+        }
+    }
+
+    Channel dqs_channel;
+    if (text_archive >> dqs_channel) {
+        mDqsChannel = dqs_channel;
+    }
+
+    bool display;
+    Channel dc_channel;
+    U32 display_width;
+    U32 display_height;
+    if ((text_archive >> display) && (text_archive >> dc_channel) && (text_archive >> display_width) && (text_archive >> display_height)) {
+        mDisplay = display;
+        mDcChannel = dc_channel;
+        mDisplayWidth = display_width;
+        mDisplayHeight = display_height;
+    }
+
+    bool collapse_repeats;
+    if (text_archive >> collapse_repeats) {
+        mCollapseRepeats = collapse_repeats;
+    }
+
+    bool auto_detect;
+    if (text_archive >> auto_detect) {
+        mAutoDetect = auto_detect;
+    }
+
+    bool independent_lines;
+    if (text_archive >> independent_lines) {
+        mIndependentLines = independent_lines;
+    }
+
     ClearChannels();
     AddChannel(mMosiChannel, "MOSI", mMosiChannel != UNDEFINED_CHANNEL);
     AddChannel(mMisoChannel, "MISO", mMisoChannel != UNDEFINED_CHANNEL);
     AddChannel(mClockChannel, "CLOCK", mClockChannel != UNDEFINED_CHANNEL);
     AddChannel(mEnableChannel, "ENABLE", mEnableChannel != UNDEFINED_CHANNEL);
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        AddChannel(mSlaveEnableChannels[i], mSlaveEnableChannelInterfaces[i]->GetTitle(), mSlaveEnableChannels[i] != UNDEFINED_CHANNEL);
+    }
+    AddChannel(mIo2Channel, "IO2", mIo2Channel != UNDEFINED_CHANNEL);
+    AddChannel(mIo3Channel, "IO3", mIo3Channel != UNDEFINED_CHANNEL);
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        AddChannel(mOctalIoChannels[i], mOctalIoChannelInterfaces[i]->GetTitle(), mOctalIoChannels[i] != UNDEFINED_CHANNEL);
+    }
+    AddChannel(mDqsChannel, "DQS", mDqsChannel != UNDEFINED_CHANNEL);
+    AddChannel(mDcChannel, "D/C", mDcChannel != UNDEFINED_CHANNEL);
 
     UpdateInterfacesFromSettings();
 }
@@ -202,6 +656,29 @@ const char *SpiAnalyzerSettings::SaveSettings()
     text_archive <<  mDataValidEdge;
     text_archive <<  mEnableActiveState;
     text_archive << mShowMarker;
+    text_archive << mFrameGranularity;
+    text_archive << mIo2Channel;
+    text_archive << mIo3Channel;
+    text_archive << mLaneMode;
+    text_archive << mAddressBytes;
+    text_archive << mDummyCycles;
+    text_archive << mNorCommands;
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        text_archive << mSlaveEnableChannels[i];
+    }
+    text_archive << mClockIdleTimeout;
+    text_archive << mSdCard;
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        text_archive << mOctalIoChannels[i];
+    }
+    text_archive << mDqsChannel;
+    text_archive << mDisplay;
+    text_archive << mDcChannel;
+    text_archive << mDisplayWidth;
+    text_archive << mDisplayHeight;
+    text_archive << mCollapseRepeats;
+    text_archive << mAutoDetect;
+    text_archive << mIndependentLines;
 
     return SetReturnString(text_archive.GetString());
 }
@@ -218,4 +695,65 @@ void SpiAnalyzerSettings::UpdateInterfacesFromSettings()
     mDataValidEdgeInterface->SetNumber(mDataValidEdge);
     mEnableActiveStateInterface->SetNumber(mEnableActiveState);
     mUseShowMarkerInterface->SetValue(mShowMarker);
-}
\ No newline at end of file
+    mFrameGranularityInterface->SetNumber(mFrameGranularity);
+    mIo2ChannelInterface->SetChannel(mIo2Channel);
+    mIo3ChannelInterface->SetChannel(mIo3Channel);
+    mLaneModeInterface->SetNumber(mLaneMode);
+    mAddressBytesInterface->SetNumber(mAddressBytes);
+    mDummyCyclesInterface->SetInteger(mDummyCycles);
+    mNorCommandsInterface->SetValue(mNorCommands);
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        mSlaveEnableChannelInterfaces[i]->SetChannel(mSlaveEnableChannels[i]);
+    }
+    mClockIdleTimeoutInterface->SetInteger(mClockIdleTimeout);
+    mSdCardInterface->SetValue(mSdCard);
+    for (U32 i = 0; i < SPI_MAX_LANES - 4; i++) {
+        mOctalIoChannelInterfaces[i]->SetChannel(mOctalIoChannels[i]);
+    }
+    mDqsChannelInterface->SetChannel(mDqsChannel);
+    mDisplayInterface->SetValue(mDisplay);
+    mDcChannelInterface->SetChannel(mDcChannel);
+    mDisplayWidthInterface->SetInteger(mDisplayWidth);
+    mDisplayHeightInterface->SetInteger(mDisplayHeight);
+    mCollapseRepeatsInterface->SetValue(mCollapseRepeats);
+    mAutoDetectInterface->SetValue(mAutoDetect);
+    mIndependentLinesInterface->SetValue(mIndependentLines);
+}
+
+bool SpiAnalyzerSettings::IsMultiSlave() const
+{
+    for (U32 i = 0; i < SPI_MAX_SLAVES - 1; i++) {
+        if (mSlaveEnableChannels[i] != UNDEFINED_CHANNEL) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Channel SpiAnalyzerSettings::GetEnableChannel(U32 slave) const
+{
+    if (slave == 0) {
+        return mEnableChannel;
+    }
+
+    return mSlaveEnableChannels[slave - 1];
+}
+
+Channel SpiAnalyzerSettings::GetIoChannel(U32 line) const
+{
+    if (line == 0) {
+        return mMosiChannel;
+    }
+    if (line == 1) {
+        return mMisoChannel;
+    }
+    if (line == 2) {
+        return mIo2Channel;
+    }
+    if (line == 3) {
+        return mIo3Channel;
+    }
+
+    return mOctalIoChannels[line - 4];
+}
@@ -4,6 +4,15 @@
 #include <AnalyzerSettings.h>
 #include <AnalyzerTypes.h>
 
+#define SPI_MAX_SLAVES 4    //the Enable channel plus up to 3 more enable lines sharing the clock and data lines
+#define SPI_MAX_LANES 8     //octal modes: IO0-IO7
+
+namespace SpiAnalyzerEnums
+{
+    enum FrameGranularity { FramePerWord, FramePerTransaction };
+    enum LaneMode { SingleLane, Dual112, Dual122, Quad114, Quad144, Quad444, Octal118, Octal188, Octal888, Octal888Dtr };  //command-address-data lane widths
+};
+
 class SpiAnalyzerSettings : public AnalyzerSettings
 {
 public:
@@ -20,24 +29,66 @@ public:
     Channel mMisoChannel;
     Channel mClockChannel;
     Channel mEnableChannel;
+    Channel mIo2Channel;
+    Channel mIo3Channel;
+    Channel mOctalIoChannels[SPI_MAX_LANES - 4];   //IO4-IO7
+    Channel mDqsChannel;                            //octal DTR only: read data strobe, UNDEFINED_CHANNEL if unused
+    Channel mSlaveEnableChannels[SPI_MAX_SLAVES - 1];   //enable lines of more slaves, UNDEFINED_CHANNEL if unused
     AnalyzerEnums::ShiftOrder mShiftOrder;
     U32 mBitsPerTransfer;
     BitState mClockInactiveState;
     AnalyzerEnums::Edge mDataValidEdge;
     BitState mEnableActiveState;
     bool  mShowMarker;
+    SpiAnalyzerEnums::FrameGranularity mFrameGranularity;
+    SpiAnalyzerEnums::LaneMode mLaneMode;
+    U32 mAddressBytes;
+    U32 mDummyCycles;
+    bool mNorCommands;
+    U32 mClockIdleTimeout;      //microseconds; without an enable line, a clock idle this long ends the transaction. 0 to turn off
+    bool mSdCard;               //decode SD card commands, responses and data blocks instead of words
+    bool mDisplay;              //decode display controller commands, parameters and pixel data instead of words
+    Channel mDcChannel;         //display decoding: data/command select, low for commands. UNDEFINED_CHANNEL for 3-wire panels
+    U32 mDisplayWidth;          //display decoding: frame memory size, for the PPM export
+    U32 mDisplayHeight;
+    bool mCollapseRepeats;      //show a run of identical transactions as the first one and a single repeat frame
+    bool mAutoDetect;           //check the clock mode and word size against the first transactions, and decode again if they don't fit
+    bool mIndependentLines;     //MOSI, MISO and IO2-IO7 each carry the words of their own device, on the shared clock and enable
+
+    bool IsMultiSlave() const;
+    Channel GetEnableChannel(U32 slave) const;  //slave 0 is the Enable channel
+    Channel GetIoChannel(U32 line) const;       //line 0 is MOSI, 1 MISO, then IO2-IO7
 
 protected:
     std::auto_ptr< AnalyzerSettingInterfaceChannel >    mMosiChannelInterface;
     std::auto_ptr< AnalyzerSettingInterfaceChannel >    mMisoChannelInterface;
     std::auto_ptr< AnalyzerSettingInterfaceChannel >    mClockChannelInterface;
     std::auto_ptr< AnalyzerSettingInterfaceChannel >    mEnableChannelInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceChannel >    mIo2ChannelInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceChannel >    mIo3ChannelInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceChannel >    mOctalIoChannelInterfaces[SPI_MAX_LANES - 4];
+    std::auto_ptr< AnalyzerSettingInterfaceChannel >    mDqsChannelInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceChannel >    mSlaveEnableChannelInterfaces[SPI_MAX_SLAVES - 1];
     std::auto_ptr< AnalyzerSettingInterfaceNumberList > mShiftOrderInterface;
     std::auto_ptr< AnalyzerSettingInterfaceNumberList > mBitsPerTransferInterface;
     std::auto_ptr< AnalyzerSettingInterfaceNumberList > mClockInactiveStateInterface;
     std::auto_ptr< AnalyzerSettingInterfaceNumberList > mDataValidEdgeInterface;
     std::auto_ptr< AnalyzerSettingInterfaceNumberList > mEnableActiveStateInterface;
     std::auto_ptr< AnalyzerSettingInterfaceBool >       mUseShowMarkerInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceNumberList > mFrameGranularityInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceNumberList > mLaneModeInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceNumberList > mAddressBytesInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceInteger >    mDummyCyclesInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceBool >       mNorCommandsInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceInteger >    mClockIdleTimeoutInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceBool >       mSdCardInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceBool >       mDisplayInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceChannel >    mDcChannelInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceInteger >    mDisplayWidthInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceInteger >    mDisplayHeightInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceBool >       mCollapseRepeatsInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceBool >       mAutoDetectInterface;
+    std::auto_ptr< AnalyzerSettingInterfaceBool >       mIndependentLinesInterface;
 };
 
 #endif //SPI_ANALYZER_SETTINGS
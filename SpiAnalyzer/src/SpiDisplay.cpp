@@ -0,0 +1,372 @@
+#include "SpiDisplay.h"
+#include "SpiAnalyzerResults.h"
+#include <cstring>
+#include <cstdio>
+
+#pragma warning(disable: 4996) //warning C4996: 'sprintf': This function or variable may be unsafe. Consider using sprintf_s instead.
+
+#define DISPLAY_MAX_PARAMETER_RUN 8         //parameters per parameter frame
+#define DISPLAY_MAX_PIXEL_RUN 0xFFFFFF      //bytes per pixel data frame, the size of its byte count
+
+namespace
+{
+    const SpiDisplayCommand DISPLAY_COMMANDS[] = {
+        //opcode, mnemonic, name, read, pixel data
+        { 0x00, "NOP", "No Operation", false, false },
+        { 0x01, "SWRESET", "Software Reset", false, false },
+        { 0x04, "RDDID", "Read Display ID", true, false },
+        { 0x09, "RDDST", "Read Display Status", true, false },
+        { 0x0A, "RDDPM", "Read Display Power Mode", true, false },
+        { 0x0B, "RDDMADCTL", "Read Display MADCTL", true, false },
+        { 0x0C, "RDDCOLMOD", "Read Display Pixel Format", true, false },
+        { 0x0F, "RDDSDR", "Read Display Self-Diagnostic Result", true, false },
+        { 0x10, "SLPIN", "Sleep In", false, false },
+        { 0x11, "SLPOUT", "Sleep Out", false, false },
+        { 0x12, "PTLON", "Partial Mode On", false, false },
+        { 0x13, "NORON", "Normal Display Mode On", false, false },
+        { 0x20, "INVOFF", "Display Inversion Off", false, false },
+        { 0x21, "INVON", "Display Inversion On", false, false },
+        { 0x26, "GAMSET", "Gamma Set", false, false },
+        { 0x28, "DISPOFF", "Display Off", false, false },
+        { 0x29, "DISPON", "Display On", false, false },
+        { 0x2A, "CASET", "Column Address Set", false, false },
+        { 0x2B, "RASET", "Row Address Set", false, false },
+        { 0x2C, "RAMWR", "Memory Write", false, true },
+        { 0x2E, "RAMRD", "Memory Read", true, false },
+        { 0x30, "PTLAR", "Partial Area", false, false },
+        { 0x33, "VSCRDEF", "Vertical Scrolling Definition", false, false },
+        { 0x34, "TEOFF", "Tearing Effect Line Off", false, false },
+        { 0x35, "TEON", "Tearing Effect Line On", false, false },
+        { 0x36, "MADCTL", "Memory Data Access Control", false, false },
+        { 0x37, "VSCSAD", "Vertical Scroll Start Address", false, false },
+        { 0x38, "IDMOFF", "Idle Mode Off", false, false },
+        { 0x39, "IDMON", "Idle Mode On", false, false },
+        { 0x3A, "COLMOD", "Interface Pixel Format", false, false },
+        { 0x3C, "RAMWRC", "Memory Write Continue", false, true },
+        { 0x3E, "RAMRDC", "Memory Read Continue", true, false },
+        { 0x44, "TESCAN", "Set Tear Scanline", false, false },
+        { 0x45, "RDTESCAN", "Get Scanline", true, false },
+        { 0x51, "WRDISBV", "Write Display Brightness", false, false },
+        { 0x52, "RDDISBV", "Read Display Brightness", true, false },
+        { 0x53, "WRCTRLD", "Write CTRL Display", false, false },
+        { 0x54, "RDCTRLD", "Read CTRL Display", true, false },
+        { 0x55, "WRCACE", "Write Content Adaptive Brightness Control", false, false },
+        { 0xDA, "RDID1", "Read ID1", true, false },
+        { 0xDB, "RDID2", "Read ID2", true, false },
+        { 0xDC, "RDID3", "Read ID3", true, false },
+    };
+
+    //opcode -> position in DISPLAY_COMMANDS + 1; filled in once when the library is loaded
+    class SpiDisplayCommandIndex
+    {
+    public:
+        SpiDisplayCommandIndex()
+        {
+            memset(mIndex, 0, sizeof(mIndex));
+            for (U32 i = 0; i < sizeof(DISPLAY_COMMANDS) / sizeof(DISPLAY_COMMANDS[0]); i++) {
+                mIndex[DISPLAY_COMMANDS[i].mOpcode] = U8(i + 1);
+            }
+        }
+
+        U8 mIndex[256];
+    };
+
+    const SpiDisplayCommandIndex DISPLAY_COMMAND_INDEX;
+
+    //COLMOD: the interface format is in the low 3 bits; 18 bit colors take 3 bytes, 16 bit colors 2
+    U32 GetBytesPerPixel(U8 pixel_format)
+    {
+        return ((pixel_format & 0x7) == 0x6) ? 3 : 2;
+    }
+}
+
+const SpiDisplayCommand *GetSpiDisplayCommand(U8 opcode)
+{
+    U8 index = DISPLAY_COMMAND_INDEX.mIndex[opcode];
+    if (index == 0) {
+        return NULL;
+    }
+
+    return &DISPLAY_COMMANDS[index - 1];
+}
+
+SpiDisplayDecoder::SpiDisplayDecoder()
+    :   mResults(NULL),
+        mReadOnMiso(false),
+        mOpcode(0),
+        mCommand(NULL),
+        mParameterIndex(0),
+        mRunLength(0),
+        mRunFirstIndex(0),
+        mRunValue(0),
+        mRunFirstWord(0),
+        mRunStartingSample(0),
+        mRunEndingSample(0)
+{
+}
+
+SpiDisplayDecoder::~SpiDisplayDecoder()
+{
+}
+
+void SpiDisplayDecoder::Reset(SpiAnalyzerResults *results, bool read_on_miso)
+{
+    mResults = results;
+    mReadOnMiso = read_on_miso;
+    mOpcode = 0;
+    mCommand = NULL;
+    mParameterIndex = 0;
+    mRunLength = 0;
+}
+
+void SpiDisplayDecoder::AddByte(U64 starting_sample, U64 ending_sample, U8 mosi, U8 miso, bool command, std::vector<Frame> &frames)
+{
+    if (command == true) {
+        CompleteRun(frames);
+
+        mOpcode = mosi;
+        mCommand = GetSpiDisplayCommand(mosi);
+        mParameterIndex = 0;
+
+        Frame frame;
+        frame.mStartingSampleInclusive = starting_sample;
+        frame.mEndingSampleInclusive = ending_sample;
+        frame.mData1 = mosi;
+        frame.mData2 = 0;
+        frame.mType = SpiDisplayCommandFrame;
+        frame.mFlags = 0;
+        frames.push_back(frame);
+        return;
+    }
+
+    bool pixel_data = (mCommand != NULL) && (mCommand->mPixelData == true);
+    bool read = (mCommand != NULL) && (mCommand->mRead == true);
+
+    if (mRunLength == 0) {
+        mRunFirstIndex = mParameterIndex;
+        mRunValue = 0;
+        mRunStartingSample = starting_sample;
+        if (pixel_data == true) {
+            mRunFirstWord = mResults->GetPayloadWordCount();
+        }
+    }
+
+    if (pixel_data == true) {
+        mResults->AddPayloadWord(mosi, miso);
+    } else {
+        mRunValue = (mRunValue << 8) | (((read == true) && (mReadOnMiso == true)) ? miso : mosi);
+    }
+    mRunLength++;
+    mRunEndingSample = ending_sample;
+    mParameterIndex++;
+
+    if (mRunLength == ((pixel_data == true) ? DISPLAY_MAX_PIXEL_RUN : DISPLAY_MAX_PARAMETER_RUN)) {
+        CompleteRun(frames);
+    }
+}
+
+//the enable line went inactive. The controller keeps the command, so parameters after the next assertion carry on from here.
+void SpiDisplayDecoder::EndTransaction(std::vector<Frame> &frames)
+{
+    CompleteRun(frames);
+}
+
+void SpiDisplayDecoder::CompleteRun(std::vector<Frame> &frames)
+{
+    if (mRunLength == 0) {
+        return;
+    }
+
+    bool pixel_data = (mCommand != NULL) && (mCommand->mPixelData == true);
+
+    Frame frame;
+    frame.mStartingSampleInclusive = mRunStartingSample;
+    frame.mEndingSampleInclusive = mRunEndingSample;
+    frame.mData1 = (pixel_data == true) ? mRunFirstWord : mRunValue;
+    frame.mData2 = mOpcode | (U64(mRunLength) << 8) | (U64(mRunFirstIndex) << 32);
+    frame.mType = (pixel_data == true) ? SpiDisplayPixelFrame : SpiDisplayParameterFrame;
+    frame.mFlags = 0;
+    frames.push_back(frame);
+
+    mRunLength = 0;
+}
+
+SpiDisplayFramebuffer::SpiDisplayFramebuffer(U32 width, U32 height)
+    :   mWidth(width),
+        mHeight(height),
+        mPixels(width * height, 0),
+        mDrawnInFrame(width * height, 0),
+        mFrame(1),
+        mDrawn(false),
+        mPending(false),
+        mPendingOffset(0),
+        mPendingColor(0)
+{
+    Reset();
+}
+
+SpiDisplayFramebuffer::~SpiDisplayFramebuffer()
+{
+}
+
+//the state after a reset, except for the pixel format: nearly every driver selects 16 bits, and captures often start after COLMOD
+void SpiDisplayFramebuffer::Reset()
+{
+    mMemoryAccess = 0x00;
+    mPixelFormat = 0x55;
+    mColumnStart = 0;
+    mColumnEnd = U16(mWidth - 1);
+    mRowStart = 0;
+    mRowEnd = U16(mHeight - 1);
+    mColumn = 0;
+    mRow = 0;
+    mPixelByteCount = 0;
+}
+
+void SpiDisplayFramebuffer::AddCommand(U8 opcode)
+{
+    switch (opcode) {
+    case 0x01:  //SWRESET
+        Reset();
+        break;
+    case 0x2C:  //RAMWR starts at the top left of the window
+        mColumn = mColumnStart;
+        mRow = mRowStart;
+        mPixelByteCount = 0;
+        break;
+    case 0x3C:  //RAMWRC carries on where the last write stopped
+        mPixelByteCount = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+void SpiDisplayFramebuffer::AddParameter(U8 opcode, U32 index, U8 value)
+{
+    //CASET/RASET: start and end, most significant byte first
+    U16 *address = NULL;
+    if (opcode == 0x2A) {
+        address = (index < 2) ? &mColumnStart : &mColumnEnd;
+    } else if (opcode == 0x2B) {
+        address = (index < 2) ? &mRowStart : &mRowEnd;
+    }
+
+    if ((address != NULL) && (index < 4)) {
+        if ((index & 0x1) == 0) {
+            *address = U16((value << 8) | (*address & 0xFF));
+        } else {
+            *address = U16((*address & 0xFF00) | value);
+        }
+    } else if ((opcode == 0x36) && (index == 0)) {
+        mMemoryAccess = value;
+    } else if ((opcode == 0x3A) && (index == 0)) {
+        mPixelFormat = value;
+    }
+}
+
+bool SpiDisplayFramebuffer::AddPixelByte(U8 value)
+{
+    mPixelBytes[mPixelByteCount++] = value;
+    U32 bytes_per_pixel = GetBytesPerPixel(mPixelFormat);
+    if (mPixelByteCount < bytes_per_pixel) {
+        return false;
+    }
+    mPixelByteCount = 0;
+
+    U16 color;
+    if (bytes_per_pixel == 3) {     //6 bits per color, in the upper bits of each byte
+        color = U16(((mPixelBytes[0] & 0xF8) << 8) | ((mPixelBytes[1] & 0xFC) << 3) | (mPixelBytes[2] >> 3));
+    } else {
+        color = U16((mPixelBytes[0] << 8) | mPixelBytes[1]);
+    }
+    if ((mMemoryAccess & 0x08) != 0) {  //BGR panel: the first color goes to the blue subpixels
+        color = U16((color >> 11) | (color & 0x07E0) | ((color & 0x1F) << 11));
+    }
+
+    //where the pixel lands in the frame memory: MV exchanges columns and rows, then MX and MY mirror them
+    U32 x = mColumn;
+    U32 y = mRow;
+    if ((mMemoryAccess & 0x20) != 0) {
+        x = mRow;
+        y = mColumn;
+    }
+    AdvancePointer();
+
+    if ((x >= mWidth) || (y >= mHeight)) {
+        return false;
+    }
+    if ((mMemoryAccess & 0x40) != 0) {
+        x = mWidth - 1 - x;
+    }
+    if ((mMemoryAccess & 0x80) != 0) {
+        y = mHeight - 1 - y;
+    }
+
+    U32 offset = y * mWidth + x;
+    if (mDrawnInFrame[offset] == mFrame) {
+        mPending = true;
+        mPendingOffset = offset;
+        mPendingColor = color;
+        return true;
+    }
+
+    mPixels[offset] = color;
+    mDrawnInFrame[offset] = mFrame;
+    mDrawn = true;
+    return false;
+}
+
+void SpiDisplayFramebuffer::StartFrame()
+{
+    mFrame++;
+    mDrawn = false;
+
+    if (mPending == true) {
+        mPixels[mPendingOffset] = mPendingColor;
+        mDrawnInFrame[mPendingOffset] = mFrame;
+        mDrawn = true;
+        mPending = false;
+    }
+}
+
+bool SpiDisplayFramebuffer::IsDrawn() const
+{
+    return mDrawn;
+}
+
+void SpiDisplayFramebuffer::GetImage(std::vector<U8> &ppm) const
+{
+    char header[64];
+    sprintf(header, "P6\n%u %u\n255\n", mWidth, mHeight);
+    U32 header_length = U32(strlen(header));
+
+    ppm.resize(header_length + 3 * mPixels.size());
+    memcpy(&ppm[0], header, header_length);
+
+    U8 *rgb = &ppm[header_length];
+    for (U32 i = 0; i < mPixels.size(); i++) {
+        U16 color = mPixels[i];
+        U8 red = U8(color >> 11);
+        U8 green = U8((color >> 5) & 0x3F);
+        U8 blue = U8(color & 0x1F);
+        rgb[3 * i] = U8((red << 3) | (red >> 2));
+        rgb[3 * i + 1] = U8((green << 2) | (green >> 4));
+        rgb[3 * i + 2] = U8((blue << 3) | (blue >> 2));
+    }
+}
+
+//left to right along the window's columns, then down its rows, back to the top left after the last pixel
+void SpiDisplayFramebuffer::AdvancePointer()
+{
+    if (mColumn >= mColumnEnd) {
+        mColumn = mColumnStart;
+        if (mRow >= mRowEnd) {
+            mRow = mRowStart;
+        } else {
+            mRow++;
+        }
+    } else {
+        mColumn++;
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef SPI_DISPLAY
+#define SPI_DISPLAY
+
+#include <AnalyzerResults.h>
+#include <vector>
+
+//one command of an MIPI DCS display controller (ST7789, ILI9341 and the like)
+struct SpiDisplayCommand {
+    U8 mOpcode;
+    const char *mMnemonic;
+    const char *mName;
+    bool mRead;                 //the parameters come from the controller
+    bool mPixelData;            //the parameters are frame memory data, kept in the payload buffers
+};
+
+//NULL for commands that aren't in the table
+const SpiDisplayCommand *GetSpiDisplayCommand(U8 opcode);
+
+class SpiAnalyzerResults;
+
+//Turns the bytes of one display controller, with their D/C level, into command, parameter and pixel data frames.
+//The frames are handed back without the slave, so one decoder can run per enable line.
+class SpiDisplayDecoder
+{
+public:
+    SpiDisplayDecoder();
+    ~SpiDisplayDecoder();
+
+    void Reset(SpiAnalyzerResults *results, bool read_on_miso);
+    void AddByte(U64 starting_sample, U64 ending_sample, U8 mosi, U8 miso, bool command, std::vector<Frame> &frames);
+    void EndTransaction(std::vector<Frame> &frames);
+
+protected: //functions
+    void CompleteRun(std::vector<Frame> &frames);
+
+protected: //vars
+    SpiAnalyzerResults *mResults;
+    bool mReadOnMiso;           //4-wire: the controller answers on MISO; 3-wire panels answer on the one data line
+
+    U8 mOpcode;                 //of the last command
+    const SpiDisplayCommand *mCommand;  //NULL if the command isn't known
+    U32 mParameterIndex;        //parameters of the command so far
+
+    //the parameters not in a frame yet; up to 8 of them, or a run of pixel data in the payload buffers
+    U32 mRunLength;
+    U32 mRunFirstIndex;
+    U64 mRunValue;
+    U64 mRunFirstWord;
+    U64 mRunStartingSample;
+    U64 mRunEndingSample;
+};
+
+//The frame memory of a display controller, rebuilt from its command, parameter and pixel data frames.
+//Follows CASET/RASET, MADCTL and COLMOD, and keeps the pixels as RGB565.
+class SpiDisplayFramebuffer
+{
+public:
+    SpiDisplayFramebuffer(U32 width, U32 height);
+    ~SpiDisplayFramebuffer();
+
+    void AddCommand(U8 opcode);
+    void AddParameter(U8 opcode, U32 index, U8 value);
+
+    //a byte of RAMWR/RAMWRC data. Returns true if it completes a pixel where one has been drawn since the last call to StartFrame:
+    //the host has moved on to the next frame. The pixel is then held back, and drawn by StartFrame.
+    bool AddPixelByte(U8 value);
+    void StartFrame();
+
+    bool IsDrawn() const;       //pixels have been drawn since the last call to StartFrame
+    void GetImage(std::vector<U8> &ppm) const;  //binary PPM, 8 bits per color
+
+protected: //functions
+    void Reset();
+    void AdvancePointer();
+
+protected: //vars
+    U32 mWidth;
+    U32 mHeight;
+    std::vector<U16> mPixels;
+    std::vector<U32> mDrawnInFrame;     //per pixel: the frame that last drew it
+    U32 mFrame;
+    bool mDrawn;
+
+    U8 mMemoryAccess;           //MADCTL
+    U8 mPixelFormat;            //COLMOD
+    U16 mColumnStart;
+    U16 mColumnEnd;
+    U16 mRowStart;
+    U16 mRowEnd;
+    U16 mColumn;                //where the next pixel goes
+    U16 mRow;
+
+    U8 mPixelBytes[3];
+    U32 mPixelByteCount;
+    bool mPending;              //a pixel is held back for StartFrame
+    U32 mPendingOffset;
+    U16 mPendingColor;
+};
+
+#endif //SPI_DISPLAY
@@ -0,0 +1,200 @@
+#include "SpiNorFlash.h"
+#include <cstring>
+
+namespace
+{
+    const SpiNorCommand NOR_COMMANDS[] = {
+        //opcode, name, kind, address bytes, dummy clocks, address lanes, data lanes, data from flash, erase size
+        { 0x03, "Read", SpiNorRead, SPI_NOR_DEFAULT_ADDRESS, 0, 1, 1, true, 0 },
+        { 0x0B, "Fast Read", SpiNorRead, SPI_NOR_DEFAULT_ADDRESS, 8, 1, 1, true, 0 },
+        { 0x3B, "Dual Output Read", SpiNorRead, SPI_NOR_DEFAULT_ADDRESS, 8, 1, 2, true, 0 },
+        { 0xBB, "Dual I/O Read", SpiNorRead, SPI_NOR_DEFAULT_ADDRESS, 4, 2, 2, true, 0 },
+        { 0x6B, "Quad Output Read", SpiNorRead, SPI_NOR_DEFAULT_ADDRESS, 8, 1, 4, true, 0 },
+        { 0xEB, "Quad I/O Read", SpiNorRead, SPI_NOR_DEFAULT_ADDRESS, 6, 4, 4, true, 0 },
+        { 0x13, "Read (4-byte)", SpiNorRead, 4, 0, 1, 1, true, 0 },
+        { 0x0C, "Fast Read (4-byte)", SpiNorRead, 4, 8, 1, 1, true, 0 },
+        { 0x6C, "Quad Output Read (4-byte)", SpiNorRead, 4, 8, 1, 4, true, 0 },
+        { 0xEC, "Quad I/O Read (4-byte)", SpiNorRead, 4, 6, 4, 4, true, 0 },
+        { 0x8B, "Octal Output Read", SpiNorRead, SPI_NOR_DEFAULT_ADDRESS, 8, 1, 8, true, 0 },
+        { 0xCB, "Octal I/O Read", SpiNorRead, SPI_NOR_DEFAULT_ADDRESS, 16, 8, 8, true, 0 },
+        { 0x7C, "Octal Output Read (4-byte)", SpiNorRead, 4, 8, 1, 8, true, 0 },
+        { 0xCC, "Octal I/O Read (4-byte)", SpiNorRead, 4, 16, 8, 8, true, 0 },
+        { 0xEE, "Octal DTR Read", SpiNorRead, 4, 20, 8, 8, true, 0 },
+        { 0x02, "Page Program", SpiNorProgram, SPI_NOR_DEFAULT_ADDRESS, 0, 1, 1, false, 0 },
+        { 0x32, "Quad Page Program", SpiNorProgram, SPI_NOR_DEFAULT_ADDRESS, 0, 1, 4, false, 0 },
+        { 0x12, "Page Program (4-byte)", SpiNorProgram, 4, 0, 1, 1, false, 0 },
+        { 0x34, "Quad Page Program (4-byte)", SpiNorProgram, 4, 0, 1, 4, false, 0 },
+        { 0x82, "Octal Page Program", SpiNorProgram, SPI_NOR_DEFAULT_ADDRESS, 0, 1, 8, false, 0 },
+        { 0xC2, "Octal I/O Page Program", SpiNorProgram, SPI_NOR_DEFAULT_ADDRESS, 0, 8, 8, false, 0 },
+        { 0x20, "Sector Erase 4KB", SpiNorErase, SPI_NOR_DEFAULT_ADDRESS, 0, 1, 1, false, 4 * 1024 },
+        { 0x52, "Block Erase 32KB", SpiNorErase, SPI_NOR_DEFAULT_ADDRESS, 0, 1, 1, false, 32 * 1024 },
+        { 0xD8, "Block Erase 64KB", SpiNorErase, SPI_NOR_DEFAULT_ADDRESS, 0, 1, 1, false, 64 * 1024 },
+        { 0x21, "Sector Erase 4KB (4-byte)", SpiNorErase, 4, 0, 1, 1, false, 4 * 1024 },
+        { 0xDC, "Block Erase 64KB (4-byte)", SpiNorErase, 4, 0, 1, 1, false, 64 * 1024 },
+        { 0xC7, "Chip Erase", SpiNorErase, 0, 0, 1, 1, false, 0 },
+        { 0x60, "Chip Erase", SpiNorErase, 0, 0, 1, 1, false, 0 },
+        { 0x05, "Read Status", SpiNorStatus, 0, 0, 1, 1, true, 0 },
+        { 0x35, "Read Status 2", SpiNorStatus, 0, 0, 1, 1, true, 0 },
+        { 0x01, "Write Status", SpiNorOther, 0, 0, 1, 1, false, 0 },
+        { 0x06, "Write Enable", SpiNorOther, 0, 0, 1, 1, false, 0 },
+        { 0x04, "Write Disable", SpiNorOther, 0, 0, 1, 1, false, 0 },
+        { 0x9F, "JEDEC ID", SpiNorId, 0, 0, 1, 1, true, 0 },
+        { 0x90, "Manufacturer/Device ID", SpiNorId, 3, 0, 1, 1, true, 0 },
+        { 0xAB, "Release Power-down", SpiNorOther, 0, 24, 1, 1, true, 0 },
+        { 0xB9, "Power-down", SpiNorOther, 0, 0, 1, 1, false, 0 },
+        { 0x5A, "Read SFDP", SpiNorRead, 3, 8, 1, 1, true, 0 },
+        { 0xB7, "Enter 4-byte Mode", SpiNorOther, 0, 0, 1, 1, false, 0 },
+        { 0xE9, "Exit 4-byte Mode", SpiNorOther, 0, 0, 1, 1, false, 0 },
+        { 0x66, "Reset Enable", SpiNorOther, 0, 0, 1, 1, false, 0 },
+        { 0x99, "Reset", SpiNorOther, 0, 0, 1, 1, false, 0 },
+    };
+
+    //opcode -> position in NOR_COMMANDS + 1, 0 if unknown; filled in once when the library is loaded
+    class SpiNorCommandIndex
+    {
+    public:
+        SpiNorCommandIndex()
+        {
+            memset(mIndex, 0, sizeof(mIndex));
+            for (U32 i = 0; i < sizeof(NOR_COMMANDS) / sizeof(NOR_COMMANDS[0]); i++) {
+                mIndex[NOR_COMMANDS[i].mOpcode] = U8(i + 1);
+            }
+        }
+
+        U8 mIndex[256];
+    };
+
+    const SpiNorCommandIndex NOR_COMMAND_INDEX;
+}
+
+const SpiNorCommand *GetSpiNorCommand(U8 opcode)
+{
+    U8 index = NOR_COMMAND_INDEX.mIndex[opcode];
+    if (index == 0) {
+        return NULL;
+    }
+
+    return &NOR_COMMANDS[index - 1];
+}
+
+SpiNorFlashImage::SpiNorFlashImage()
+    :   mChipErased(false),
+        mLastSectorAddress(0),
+        mLastSector(NULL)
+{
+}
+
+SpiNorFlashImage::~SpiNorFlashImage()
+{
+}
+
+void SpiNorFlashImage::Reset()
+{
+    mSectors.clear();
+    mChipErased = false;
+    mLastSector = NULL;
+}
+
+void SpiNorFlashImage::AddErase(const SpiNorCommand *command, U64 address)
+{
+    if ((command == NULL) || (command->mKind != SpiNorErase)) {
+        return;
+    }
+
+    if (command->mEraseSize == 0) {
+        Reset();
+        mChipErased = true;
+        return;
+    }
+
+    //the block the address is in; the erase sizes are multiples of the sector size
+    U64 start = address & ~U64(command->mEraseSize - 1);
+    for (U64 sector = start; sector < start + command->mEraseSize; sector += SPI_NOR_IMAGE_SECTOR_SIZE) {
+        U8 *data = GetSectorData(sector);
+        memset(data, 0xFF, SPI_NOR_IMAGE_SECTOR_SIZE);
+        memset(data + SPI_NOR_IMAGE_SECTOR_SIZE, 1, SPI_NOR_IMAGE_SECTOR_SIZE);
+    }
+}
+
+bool SpiNorFlashImage::AddData(const SpiNorCommand *command, U64 address, U64 index, U8 value, U8 &expected)
+{
+    expected = value;
+    if (command == NULL) {
+        return true;
+    }
+
+    if (command->mKind == SpiNorProgram) {
+        //a page program wraps around to the start of its 256 byte page
+        U64 byte_address = (address & ~U64(0xFF)) | ((address + index) & 0xFF);
+        U8 *data = GetSectorData(byte_address);
+        U32 offset = U32(byte_address % SPI_NOR_IMAGE_SECTOR_SIZE);
+
+        //programming only clears bits; a byte nothing is known about is taken to have been erased
+        if (data[SPI_NOR_IMAGE_SECTOR_SIZE + offset] != 0) {
+            data[offset] &= value;
+        } else {
+            data[offset] = value;
+            data[SPI_NOR_IMAGE_SECTOR_SIZE + offset] = 1;
+        }
+        return true;
+    }
+
+    //SFDP reads the parameter table, not the memory array
+    if ((command->mKind != SpiNorRead) || (command->mOpcode == 0x5A)) {
+        return true;
+    }
+
+    U64 byte_address = address + index;
+    U8 *data = GetSectorData(byte_address);
+    U32 offset = U32(byte_address % SPI_NOR_IMAGE_SECTOR_SIZE);
+    if (data[SPI_NOR_IMAGE_SECTOR_SIZE + offset] == 0) {
+        data[offset] = value;
+        data[SPI_NOR_IMAGE_SECTOR_SIZE + offset] = 1;
+        return true;
+    }
+
+    expected = data[offset];
+    return (expected == value);
+}
+
+U64 SpiNorFlashImage::GetSize() const
+{
+    if (mSectors.empty() == true) {
+        return 0;
+    }
+
+    return mSectors.rbegin()->first + SPI_NOR_IMAGE_SECTOR_SIZE;
+}
+
+void SpiNorFlashImage::GetSector(U64 address, U8 *bytes) const
+{
+    std::map< U64, std::vector<U8> >::const_iterator it = mSectors.find(address - address % SPI_NOR_IMAGE_SECTOR_SIZE);
+    if (it == mSectors.end()) {
+        memset(bytes, 0xFF, SPI_NOR_IMAGE_SECTOR_SIZE);
+        return;
+    }
+
+    const std::vector<U8> &data = it->second;
+    for (U32 i = 0; i < SPI_NOR_IMAGE_SECTOR_SIZE; i++) {
+        bytes[i] = (data[SPI_NOR_IMAGE_SECTOR_SIZE + i] != 0) ? data[i] : 0xFF;
+    }
+}
+
+//the bytes of the sector 'address' is in, then their known flags; a sector that isn't there yet is added
+U8 *SpiNorFlashImage::GetSectorData(U64 address)
+{
+    U64 sector = address - address % SPI_NOR_IMAGE_SECTOR_SIZE;
+    if ((mLastSector != NULL) && (sector == mLastSectorAddress)) {
+        return mLastSector;
+    }
+
+    std::vector<U8> &data = mSectors[sector];
+    if (data.empty() == true) {
+        data.resize(2 * SPI_NOR_IMAGE_SECTOR_SIZE, 0xFF);
+        memset(&data[SPI_NOR_IMAGE_SECTOR_SIZE], (mChipErased == true) ? 1 : 0, SPI_NOR_IMAGE_SECTOR_SIZE);
+    }
+
+    mLastSectorAddress = sector;
+    mLastSector = &data[0];
+    return mLastSector;
+}
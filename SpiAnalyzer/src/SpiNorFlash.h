@@ -0,0 +1,62 @@
+#ifndef SPI_NOR_FLASH
+#define SPI_NOR_FLASH
+
+#include <LogicPublicTypes.h>
+#include <map>
+#include <vector>
+
+#define SPI_NOR_DEFAULT_ADDRESS 0xFF    //the command takes the 3 or 4 byte address set in the settings
+
+enum SpiNorCommandKind { SpiNorRead, SpiNorProgram, SpiNorErase, SpiNorStatus, SpiNorId, SpiNorOther };
+
+//one SPI NOR flash opcode, and the shape of the transaction it starts
+struct SpiNorCommand {
+    U8 mOpcode;
+    const char *mName;
+    SpiNorCommandKind mKind;
+    U8 mAddressBytes;           //0, 3, 4 or SPI_NOR_DEFAULT_ADDRESS
+    U8 mDummyClocks;            //mode bits included
+    U8 mAddressLanes;
+    U8 mDataLanes;
+    bool mDataFromFlash;        //the data phase is on MISO (or the IO lines driven by the flash)
+    U32 mEraseSize;             //erase commands: bytes erased, 0 for the whole chip
+};
+
+//NULL for opcodes that aren't in the table
+const SpiNorCommand *GetSpiNorCommand(U8 opcode);
+
+#define SPI_NOR_IMAGE_SECTOR_SIZE 4096
+
+//A sparse image of the flash memory, rebuilt from the erase and page program commands and the data read back.
+//Only the 4 KB sectors something is known about are kept. The changes are made as the commands are decoded,
+//without waiting for the end of the transaction or checking the write enable latch.
+class SpiNorFlashImage
+{
+public:
+    SpiNorFlashImage();
+    ~SpiNorFlashImage();
+
+    void Reset();
+
+    //erase commands: the erase, given the address (chip erases have none). Other commands are ignored.
+    void AddErase(const SpiNorCommand *command, U64 address);
+
+    //byte 'index' of the data phase of a command at 'address'. Page programs go into the image, and reads of the memory array
+    //are checked against it; bytes the image doesn't know yet are learned from the read.
+    //Returns false if the read byte differs from the image, and sets expected to the byte the image holds.
+    bool AddData(const SpiNorCommand *command, U64 address, U64 index, U8 value, U8 &expected);
+
+    U64 GetSize() const;    //one past the last sector known, 0 if nothing is
+    void GetSector(U64 address, U8 *bytes) const;   //SPI_NOR_IMAGE_SECTOR_SIZE bytes; unknown ones are 0xFF, the erased state
+
+protected: //functions
+    U8 *GetSectorData(U64 address);
+
+protected: //vars
+    std::map< U64, std::vector<U8> > mSectors;  //sector address -> its bytes, then a known flag per byte
+    bool mChipErased;           //since a chip erase, the bytes of the sectors not in mSectors are known to be 0xFF
+    U64 mLastSectorAddress;     //where the last access went, so runs of bytes skip the lookup
+    U8 *mLastSector;            //NULL if there is none
+};
+
+#endif //SPI_NOR_FLASH
@@ -0,0 +1,442 @@
+#include "SpiSdCard.h"
+#include "SpiAnalyzerResults.h"
+#include <cstring>
+
+#define SD_MAX_NCR_BYTES 8          //bytes the card may take to start its response
+#define SD_MAX_BLOCK_LENGTH 4096
+
+namespace
+{
+    const SpiSdCommand SD_COMMANDS[] = {
+        //command, name, response, data, multiple blocks, block length
+        { 0, "GO_IDLE_STATE", SpiSdR1, SpiSdNoData, false, 0 },
+        { 1, "SEND_OP_COND", SpiSdR1, SpiSdNoData, false, 0 },
+        { 6, "SWITCH_FUNC", SpiSdR1, SpiSdDataFromCard, false, 64 },
+        { 8, "SEND_IF_COND", SpiSdR7, SpiSdNoData, false, 0 },
+        { 9, "SEND_CSD", SpiSdR1, SpiSdDataFromCard, false, 16 },
+        { 10, "SEND_CID", SpiSdR1, SpiSdDataFromCard, false, 16 },
+        { 12, "STOP_TRANSMISSION", SpiSdR1b, SpiSdNoData, false, 0 },
+        { 13, "SEND_STATUS", SpiSdR2, SpiSdNoData, false, 0 },
+        { 16, "SET_BLOCKLEN", SpiSdR1, SpiSdNoData, false, 0 },
+        { 17, "READ_SINGLE_BLOCK", SpiSdR1, SpiSdDataFromCard, false, SPI_SD_DEFAULT_BLOCK },
+        { 18, "READ_MULTIPLE_BLOCK", SpiSdR1, SpiSdDataFromCard, true, SPI_SD_DEFAULT_BLOCK },
+        { 24, "WRITE_BLOCK", SpiSdR1, SpiSdDataToCard, false, SPI_SD_DEFAULT_BLOCK },
+        { 25, "WRITE_MULTIPLE_BLOCK", SpiSdR1, SpiSdDataToCard, true, SPI_SD_DEFAULT_BLOCK },
+        { 27, "PROGRAM_CSD", SpiSdR1, SpiSdDataToCard, false, 16 },
+        { 28, "SET_WRITE_PROT", SpiSdR1b, SpiSdNoData, false, 0 },
+        { 29, "CLR_WRITE_PROT", SpiSdR1b, SpiSdNoData, false, 0 },
+        { 30, "SEND_WRITE_PROT", SpiSdR1, SpiSdDataFromCard, false, 4 },
+        { 32, "ERASE_WR_BLK_START_ADDR", SpiSdR1, SpiSdNoData, false, 0 },
+        { 33, "ERASE_WR_BLK_END_ADDR", SpiSdR1, SpiSdNoData, false, 0 },
+        { 38, "ERASE", SpiSdR1b, SpiSdNoData, false, 0 },
+        { 42, "LOCK_UNLOCK", SpiSdR1, SpiSdDataToCard, false, SPI_SD_DEFAULT_BLOCK },
+        { 55, "APP_CMD", SpiSdR1, SpiSdNoData, false, 0 },
+        { 58, "READ_OCR", SpiSdR3, SpiSdNoData, false, 0 },
+        { 59, "CRC_ON_OFF", SpiSdR1, SpiSdNoData, false, 0 },
+        { SPI_SD_APP_COMMAND + 13, "SD_STATUS", SpiSdR2, SpiSdDataFromCard, false, 64 },
+        { SPI_SD_APP_COMMAND + 22, "SEND_NUM_WR_BLOCKS", SpiSdR1, SpiSdDataFromCard, false, 4 },
+        { SPI_SD_APP_COMMAND + 23, "SET_WR_BLK_ERASE_COUNT", SpiSdR1, SpiSdNoData, false, 0 },
+        { SPI_SD_APP_COMMAND + 41, "SD_SEND_OP_COND", SpiSdR1, SpiSdNoData, false, 0 },
+        { SPI_SD_APP_COMMAND + 42, "SET_CLR_CARD_DETECT", SpiSdR1, SpiSdNoData, false, 0 },
+        { SPI_SD_APP_COMMAND + 51, "SEND_SCR", SpiSdR1, SpiSdDataFromCard, false, 8 },
+    };
+
+    //command key -> position in SD_COMMANDS + 1, and the CRC tables; filled in once when the library is loaded
+    class SpiSdTables
+    {
+    public:
+        SpiSdTables()
+        {
+            memset(mIndex, 0, sizeof(mIndex));
+            for (U32 i = 0; i < sizeof(SD_COMMANDS) / sizeof(SD_COMMANDS[0]); i++) {
+                mIndex[SD_COMMANDS[i].mKey] = U8(i + 1);
+            }
+
+            //CRC7: polynomial 0x09, kept in the upper 7 bits of the table entries so a byte can be xored straight in
+            for (U32 i = 0; i < 256; i++) {
+                U8 crc = U8(i);
+                for (U32 j = 0; j < 8; j++) {
+                    if ((crc & 0x80) != 0) {
+                        crc = U8((crc << 1) ^ (0x09 << 1));
+                    } else {
+                        crc = U8(crc << 1);
+                    }
+                }
+                mCrc7[i] = crc;
+            }
+
+            //CRC16-CCITT: polynomial 0x1021, initial value 0, MSB first
+            for (U32 i = 0; i < 256; i++) {
+                U16 crc = U16(i << 8);
+                for (U32 j = 0; j < 8; j++) {
+                    if ((crc & 0x8000) != 0) {
+                        crc = U16((crc << 1) ^ 0x1021);
+                    } else {
+                        crc = U16(crc << 1);
+                    }
+                }
+                mCrc16[i] = crc;
+            }
+        }
+
+        U8 mIndex[128];
+        U8 mCrc7[256];
+        U16 mCrc16[256];
+    };
+
+    const SpiSdTables SD_TABLES;
+}
+
+const SpiSdCommand *GetSpiSdCommand(U8 key)
+{
+    U8 index = SD_TABLES.mIndex[key & 0x7F];
+    if (index == 0) {
+        return NULL;
+    }
+
+    return &SD_COMMANDS[index - 1];
+}
+
+U32 GetSpiSdResponseLength(SpiSdResponseType response)
+{
+    switch (response) {
+    case SpiSdR2:
+        return 2;
+    case SpiSdR3:
+    case SpiSdR7:
+        return 5;
+    default:
+        return 1;
+    }
+}
+
+U8 GetSpiSdCrc7(const U8 *data, U32 length)
+{
+    U8 crc = 0;
+    for (U32 i = 0; i < length; i++) {
+        crc = SD_TABLES.mCrc7[crc ^ data[i]];
+    }
+    return U8(crc >> 1);
+}
+
+U16 GetSpiSdCrc16(const U8 *data, U32 length)
+{
+    U16 crc = 0;
+    for (U32 i = 0; i < length; i++) {
+        crc = U16((crc << 8) ^ SD_TABLES.mCrc16[((crc >> 8) ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+SpiSdCardDecoder::SpiSdCardDecoder()
+    :   mResults(NULL),
+        mState(WaitCommand),
+        mStateAfterBusy(WaitCommand),
+        mItemStartingSample(0),
+        mItemEndingSample(0),
+        mItemLength(0),
+        mCommandKey(0),
+        mCommand(NULL),
+        mAppCommandNext(false),
+        mWaitBytes(0),
+        mBlockLength(512)
+{
+}
+
+SpiSdCardDecoder::~SpiSdCardDecoder()
+{
+}
+
+void SpiSdCardDecoder::Reset(SpiAnalyzerResults *results)
+{
+    mResults = results;
+    mState = WaitCommand;
+    mStateAfterBusy = WaitCommand;
+    mItem.clear();
+    mItemOtherLine.clear();
+    mCommandKey = 0;
+    mCommand = NULL;
+    mAppCommandNext = false;
+    mWaitBytes = 0;
+    mBlockLength = 512;
+}
+
+void SpiSdCardDecoder::AddByte(U64 starting_sample, U64 ending_sample, U8 mosi, U8 miso, std::vector<Frame> &frames)
+{
+    if (StartsCommand(mosi) == true) {
+        if (mState == ReadBlock) {  //CMD12 during a multiple block read: the card stops in the middle of the block
+            CompleteBlock(true, frames);
+        }
+
+        StartItem(starting_sample, ending_sample, mosi);
+        mItemLength = 6;
+        mState = CommandBytes;
+        return;
+    }
+
+    switch (mState) {
+    case CommandBytes:
+        AddItemByte(ending_sample, mosi);
+        if (mItem.size() == mItemLength) {
+            CompleteCommand(frames);
+        }
+        break;
+
+    case WaitResponse:
+        //after CMD12 the card sends a stuff byte before the response
+        if ((miso == 0xFF) || ((mCommandKey == 12) && (mWaitBytes == 0))) {
+            mWaitBytes++;
+            if (mWaitBytes > SD_MAX_NCR_BYTES) {  //no response
+                mState = WaitCommand;
+            }
+            break;
+        }
+
+        StartItem(starting_sample, ending_sample, miso);
+        mItemLength = GetSpiSdResponseLength((mCommand != NULL) ? mCommand->mResponse : SpiSdR1);
+        mState = ResponseBytes;
+        if (mItemLength == 1) {
+            CompleteResponse(frames);
+        }
+        break;
+
+    case ResponseBytes:
+        AddItemByte(ending_sample, miso);
+        if (mItem.size() == mItemLength) {
+            CompleteResponse(frames);
+        }
+        break;
+
+    case Busy:
+        if (miso != 0x00) {
+            mState = mStateAfterBusy;
+        }
+        break;
+
+    case WaitReadToken:
+        if (miso == 0xFE) {
+            StartItem(starting_sample, ending_sample, miso);
+            mItemOtherLine.push_back(mosi);
+            mItemLength = 1 + GetBlockLength() + 2;
+            mState = ReadBlock;
+        } else if ((miso != 0x00) && ((miso & 0xF0) == 0)) {  //data error token instead of the block
+            AddTokenFrame(starting_sample, ending_sample, miso, true, frames);
+            mState = WaitCommand;
+        }
+        break;
+
+    case ReadBlock:
+        AddItemByte(ending_sample, miso);
+        mItemOtherLine.push_back(mosi);
+        if (mItem.size() == mItemLength) {
+            CompleteBlock(false, frames);
+        }
+        break;
+
+    case WaitWriteToken:
+        if ((mosi == 0xFE) || ((mosi == 0xFC) && (mCommand->mMultiBlock == true))) {
+            StartItem(starting_sample, ending_sample, mosi);
+            mItemOtherLine.push_back(miso);
+            mItemLength = 1 + GetBlockLength() + 2;
+            mState = WriteBlock;
+        } else if ((mosi == 0xFD) && (mCommand->mMultiBlock == true)) {   //stop transmission token
+            AddTokenFrame(starting_sample, ending_sample, mosi, false, frames);
+            mStateAfterBusy = WaitCommand;
+            mState = Busy;
+        }
+        break;
+
+    case WriteBlock:
+        AddItemByte(ending_sample, mosi);
+        mItemOtherLine.push_back(miso);
+        if (mItem.size() == mItemLength) {
+            CompleteBlock(false, frames);
+        }
+        break;
+
+    case WaitDataResponse:
+        if (miso == 0xFF) {
+            break;
+        }
+
+        if ((miso & 0x11) == 0x01) {
+            //a multiple block write goes on with the next block once the card is done with this one
+            bool accepted = ((miso & 0x1F) == 0x05);
+            AddTokenFrame(starting_sample, ending_sample, miso, accepted == false, frames);
+
+            mStateAfterBusy = ((accepted == true) && (mCommand->mMultiBlock == true)) ? WaitWriteToken : WaitCommand;
+            mState = Busy;
+        } else {
+            mState = WaitCommand;
+        }
+        break;
+
+    default:    //WaitCommand
+        break;
+    }
+}
+
+//the enable line went inactive: the card drops a command or response it was in the middle of
+void SpiSdCardDecoder::EndTransaction(std::vector<Frame> &frames)
+{
+    if ((mState == CommandBytes) || (mState == ResponseBytes)) {
+        mState = WaitCommand;
+    } else if ((mState == ReadBlock) || (mState == WriteBlock)) {
+        CompleteBlock(true, frames);
+        mState = WaitCommand;
+    }
+}
+
+//commands start with 01 in the top bits; not checked while the host sends a command or block itself
+bool SpiSdCardDecoder::StartsCommand(U8 mosi) const
+{
+    if ((mState == CommandBytes) || (mState == WriteBlock)) {
+        return false;
+    }
+
+    return ((mosi & 0xC0) == 0x40);
+}
+
+void SpiSdCardDecoder::StartItem(U64 starting_sample, U64 ending_sample, U8 value)
+{
+    mItem.clear();
+    mItemOtherLine.clear();
+    mItem.push_back(value);
+    mItemStartingSample = starting_sample;
+    mItemEndingSample = ending_sample;
+}
+
+void SpiSdCardDecoder::AddItemByte(U64 ending_sample, U8 value)
+{
+    mItem.push_back(value);
+    mItemEndingSample = ending_sample;
+}
+
+void SpiSdCardDecoder::CompleteCommand(std::vector<Frame> &frames)
+{
+    U8 index = mItem[0] & 0x3F;
+    mCommandKey = (mAppCommandNext == true) ? U8(index + SPI_SD_APP_COMMAND) : index;
+    mCommand = GetSpiSdCommand(mCommandKey);
+    mAppCommandNext = (index == 55);
+
+    U32 argument = (U32(mItem[1]) << 24) | (U32(mItem[2]) << 16) | (U32(mItem[3]) << 8) | U32(mItem[4]);
+    if ((mCommandKey == 16) && (argument != 0) && (argument <= SD_MAX_BLOCK_LENGTH)) {
+        mBlockLength = argument;
+    }
+
+    Frame frame;
+    frame.mStartingSampleInclusive = mItemStartingSample;
+    frame.mEndingSampleInclusive = mItemEndingSample;
+    frame.mData1 = argument;
+    frame.mData2 = mCommandKey | (U64(mItem[5]) << 8);
+    frame.mType = SpiSdCommandFrame;
+    frame.mFlags = 0;
+    if (GetSpiSdCrc7(&mItem[0], 5) != (mItem[5] >> 1)) {
+        frame.mFlags = SPI_SD_CHECK_ERROR_FLAG | DISPLAY_AS_WARNING_FLAG;
+    }
+    frames.push_back(frame);
+
+    mWaitBytes = 0;
+    mState = WaitResponse;
+}
+
+void SpiSdCardDecoder::CompleteResponse(std::vector<Frame> &frames)
+{
+    U64 value = 0;
+    for (U32 i = 0; i < mItem.size(); i++) {
+        value = (value << 8) | mItem[i];
+    }
+
+    //R1 bits 1-6 are errors; bit 0 only says the card is still initializing
+    U8 r1 = mItem[0];
+    bool error = ((r1 & 0x7E) != 0);
+
+    Frame frame;
+    frame.mStartingSampleInclusive = mItemStartingSample;
+    frame.mEndingSampleInclusive = mItemEndingSample;
+    frame.mData1 = value;
+    frame.mData2 = mCommandKey | (U64(mItemLength) << 8);
+    frame.mType = SpiSdResponseFrame;
+    frame.mFlags = (error == true) ? (SPI_SD_CHECK_ERROR_FLAG | DISPLAY_AS_WARNING_FLAG) : 0;
+    frames.push_back(frame);
+
+    mState = WaitCommand;
+    if ((mCommand == NULL) || (error == true)) {
+        return;
+    }
+
+    if (mCommand->mResponse == SpiSdR1b) {
+        mStateAfterBusy = WaitCommand;
+        mState = Busy;
+    } else if (mCommand->mData == SpiSdDataFromCard) {
+        mState = WaitReadToken;
+    } else if (mCommand->mData == SpiSdDataToCard) {
+        mState = WaitWriteToken;
+    }
+}
+
+//the data bytes go to the results' payload buffers, the frame keeps the token and CRC
+void SpiSdCardDecoder::CompleteBlock(bool stopped, std::vector<Frame> &frames)
+{
+    bool from_card = (mState == ReadBlock);
+    U32 data_length = U32(mItem.size()) - 1;
+    U16 crc = 0;
+    if (stopped == false) {
+        data_length -= 2;
+        crc = U16((mItem[mItem.size() - 2] << 8) | mItem[mItem.size() - 1]);
+    } else if (data_length > GetBlockLength()) {
+        data_length = GetBlockLength();
+    }
+
+    U64 first_word = mResults->GetPayloadWordCount();
+    for (U32 i = 1; i <= data_length; i++) {
+        if (from_card == true) {
+            mResults->AddPayloadWord(mItemOtherLine[i], mItem[i]);
+        } else {
+            mResults->AddPayloadWord(mItem[i], mItemOtherLine[i]);
+        }
+    }
+
+    Frame frame;
+    frame.mStartingSampleInclusive = mItemStartingSample;
+    frame.mEndingSampleInclusive = mItemEndingSample;
+    frame.mData1 = first_word;
+    frame.mData2 = mCommandKey | (U64(data_length) << 8) | (U64(crc) << 32);
+    frame.mType = SpiSdBlockFrame;
+    frame.mFlags = 0;
+    if (stopped == true) {
+        frame.mFlags = SPI_SD_INCOMPLETE_FLAG;
+    } else if (GetSpiSdCrc16(&mItem[1], data_length) != crc) {
+        frame.mFlags = SPI_SD_CHECK_ERROR_FLAG | DISPLAY_AS_WARNING_FLAG;
+    }
+    frames.push_back(frame);
+
+    if (from_card == false) {
+        mState = WaitDataResponse;
+    } else if (mCommand->mMultiBlock == true) {
+        mState = WaitReadToken;
+    } else {
+        mState = WaitCommand;
+    }
+}
+
+void SpiSdCardDecoder::AddTokenFrame(U64 starting_sample, U64 ending_sample, U8 token, bool error, std::vector<Frame> &frames)
+{
+    Frame frame;
+    frame.mStartingSampleInclusive = starting_sample;
+    frame.mEndingSampleInclusive = ending_sample;
+    frame.mData1 = token;
+    frame.mData2 = mCommandKey;
+    frame.mType = SpiSdTokenFrame;
+    frame.mFlags = (error == true) ? (SPI_SD_CHECK_ERROR_FLAG | DISPLAY_AS_WARNING_FLAG) : 0;
+    frames.push_back(frame);
+}
+
+U32 SpiSdCardDecoder::GetBlockLength() const
+{
+    if ((mCommand == NULL) || (mCommand->mBlockLength == SPI_SD_DEFAULT_BLOCK)) {
+        return mBlockLength;
+    }
+
+    return mCommand->mBlockLength;
+}
@@ -0,0 +1,78 @@
+#ifndef SPI_SD_CARD
+#define SPI_SD_CARD
+
+#include <AnalyzerResults.h>
+#include <vector>
+
+#define SPI_SD_APP_COMMAND 0x40     //added to the command index of the ACMDs, the commands that follow CMD55
+#define SPI_SD_DEFAULT_BLOCK 0      //the command moves blocks of the length set with CMD16
+
+enum SpiSdResponseType { SpiSdR1, SpiSdR1b, SpiSdR2, SpiSdR3, SpiSdR7 };
+enum SpiSdDataDirection { SpiSdNoData, SpiSdDataFromCard, SpiSdDataToCard };
+
+//one SD card command in SPI mode, and what follows it on the bus
+struct SpiSdCommand {
+    U8 mKey;                        //command index, + SPI_SD_APP_COMMAND for the ACMDs
+    const char *mName;
+    SpiSdResponseType mResponse;
+    SpiSdDataDirection mData;
+    bool mMultiBlock;               //data blocks follow until CMD12 (reads) or the stop token (writes)
+    U32 mBlockLength;               //bytes per data block, or SPI_SD_DEFAULT_BLOCK
+};
+
+//NULL for commands that aren't in the table
+const SpiSdCommand *GetSpiSdCommand(U8 key);
+
+//bytes of the response, R1 included
+U32 GetSpiSdResponseLength(SpiSdResponseType response);
+
+//CRC7 of a command (returned in the low 7 bits) and CRC16-CCITT of a data block, as the card computes them
+U8 GetSpiSdCrc7(const U8 *data, U32 length);
+U16 GetSpiSdCrc16(const U8 *data, U32 length);
+
+class SpiAnalyzerResults;
+
+//Turns the bytes of one card's SPI bus into command, response, data block and token frames.
+//The frames are handed back without the slave, so one decoder can run per enable line.
+class SpiSdCardDecoder
+{
+public:
+    SpiSdCardDecoder();
+    ~SpiSdCardDecoder();
+
+    void Reset(SpiAnalyzerResults *results);
+    void AddByte(U64 starting_sample, U64 ending_sample, U8 mosi, U8 miso, std::vector<Frame> &frames);
+    void EndTransaction(std::vector<Frame> &frames);
+
+protected: //functions
+    bool StartsCommand(U8 mosi) const;
+    void StartItem(U64 starting_sample, U64 ending_sample, U8 value);
+    void AddItemByte(U64 ending_sample, U8 value);
+    void CompleteCommand(std::vector<Frame> &frames);
+    void CompleteResponse(std::vector<Frame> &frames);
+    void CompleteBlock(bool stopped, std::vector<Frame> &frames);
+    void AddTokenFrame(U64 starting_sample, U64 ending_sample, U8 token, bool error, std::vector<Frame> &frames);
+    U32 GetBlockLength() const;
+
+protected: //vars
+    SpiAnalyzerResults *mResults;
+
+    enum State { WaitCommand, CommandBytes, WaitResponse, ResponseBytes, Busy, WaitReadToken, ReadBlock, WaitWriteToken, WriteBlock, WaitDataResponse };
+    State mState;
+    State mStateAfterBusy;
+
+    //the command, response or block being collected; blocks keep both lines for the payload buffers
+    std::vector<U8> mItem;
+    std::vector<U8> mItemOtherLine;
+    U64 mItemStartingSample;
+    U64 mItemEndingSample;
+    U32 mItemLength;            //bytes the item will have when complete
+
+    U8 mCommandKey;             //of the last command, + SPI_SD_APP_COMMAND if it followed CMD55
+    const SpiSdCommand *mCommand;   //NULL if the command isn't known
+    bool mAppCommandNext;       //the last command was CMD55
+    U32 mWaitBytes;             //bytes since the command, while waiting for the response
+    U32 mBlockLength;           //from CMD16
+};
+
+#endif //SPI_SD_CARD
@@ -1,5 +1,8 @@
 #include "SpiSimulationDataGenerator.h"
 #include "SpiAnalyzerSettings.h"
+#include "SpiNorFlash.h"
+#include "SpiSdCard.h"
+#include <vector>
 
 SpiSimulationDataGenerator::SpiSimulationDataGenerator()
 {
@@ -30,15 +33,52 @@ void SpiSimulationDataGenerator::Initialize(U32 simulation_sample_rate, SpiAnaly
 
     mClock = mSpiSimulationChannels.Add(settings->mClockChannel, mSimulationSampleRateHz, mSettings->mClockInactiveState);
 
-    if (settings->mEnableChannel != UNDEFINED_CHANNEL) {
-        mEnable = mSpiSimulationChannels.Add(settings->mEnableChannel, mSimulationSampleRateHz, Invert(mSettings->mEnableActiveState));
+    for (U32 i = 0; i < SPI_MAX_SLAVES; i++) {
+        Channel enable_channel = settings->GetEnableChannel(i);
+        if (enable_channel != UNDEFINED_CHANNEL) {
+            mEnables[i] = mSpiSimulationChannels.Add(enable_channel, mSimulationSampleRateHz, Invert(mSettings->mEnableActiveState));
+        } else {
+            mEnables[i] = NULL;
+        }
+    }
+    mEnable = mEnables[0];
+    mSlave = 0;
+
+    mIo[0] = mMosi;
+    mIo[1] = mMiso;
+    for (U32 i = 2; i < SPI_MAX_LANES; i++) {
+        mIo[i] = NULL;
+    }
+    if (settings->mIo2Channel != UNDEFINED_CHANNEL) {
+        mIo[2] = mSpiSimulationChannels.Add(settings->mIo2Channel, mSimulationSampleRateHz, BIT_LOW);
+    }
+    if (settings->mIo3Channel != UNDEFINED_CHANNEL) {
+        mIo[3] = mSpiSimulationChannels.Add(settings->mIo3Channel, mSimulationSampleRateHz, BIT_LOW);
+    }
+    for (U32 i = 4; i < SPI_MAX_LANES; i++) {
+        if (settings->mOctalIoChannels[i - 4] != UNDEFINED_CHANNEL) {
+            mIo[i] = mSpiSimulationChannels.Add(settings->mOctalIoChannels[i - 4], mSimulationSampleRateHz, BIT_LOW);
+        }
+    }
+
+    if (settings->mDqsChannel != UNDEFINED_CHANNEL) {
+        mDqs = mSpiSimulationChannels.Add(settings->mDqsChannel, mSimulationSampleRateHz, BIT_LOW);
+    } else {
+        mDqs = NULL;
+    }
+
+    if (settings->mDcChannel != UNDEFINED_CHANNEL) {
+        mDc = mSpiSimulationChannels.Add(settings->mDcChannel, mSimulationSampleRateHz, BIT_HIGH);
     } else {
-        mEnable = NULL;
+        mDc = NULL;
     }
 
     mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(10.0));     //insert 10 bit-periods of idle
 
     mValue = 0;
+    mNorStep = 0;
+    mSdStep = 0;
+    mDisplayStep = 0;
 }
 
 U32 SpiSimulationDataGenerator::GenerateSimulationData(U64 largest_sample_requested, U32 sample_rate, SimulationChannelDescriptor **simulation_channels)
@@ -46,7 +86,27 @@ U32 SpiSimulationDataGenerator::GenerateSimulationData(U64 largest_sample_reques
     U64 adjusted_largest_sample_requested = AnalyzerHelpers::AdjustSimulationTargetSample(largest_sample_requested, sample_rate, mSimulationSampleRateHz);
 
     while (mClock->GetCurrentSampleNumber() < adjusted_largest_sample_requested) {
-        CreateSpiTransaction();
+        //several slaves: address them in turn
+        if (mSettings->IsMultiSlave() == true) {
+            do {
+                mSlave = (mSlave + 1) % SPI_MAX_SLAVES;
+            } while (mEnables[mSlave] == NULL);
+            mEnable = mEnables[mSlave];
+        }
+
+        if (mSettings->mSdCard == true) {
+            CreateSdTransaction();
+        } else if (mSettings->mDisplay == true) {
+            CreateDisplayTransaction();
+        } else if (mSettings->mNorCommands == true) {
+            CreateNorTransaction();
+        } else if (mSettings->mIndependentLines == true) {
+            CreateIndependentTransaction();
+        } else if (mSettings->mLaneMode != SpiAnalyzerEnums::SingleLane) {
+            CreateLaneTransaction();
+        } else {
+            CreateSpiTransaction();
+        }
 
         mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(20.0));  //insert 20 bit-periods of idle
     }
@@ -161,3 +221,474 @@ void SpiSimulationDataGenerator::OutputWord_CPHA1(U64 mosi_data, U64 miso_data)
 
     mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
 }
+
+//a fast read in the selected dual/quad/octal mode: command, address, dummy clocks and four data bytes
+void SpiSimulationDataGenerator::CreateLaneTransaction()
+{
+    U32 command_lanes = 1;
+    U32 address_lanes = 1;
+    U32 data_lanes = 4;
+    U64 command = 0xEB;
+
+    switch (mSettings->mLaneMode) {
+    case SpiAnalyzerEnums::Dual112:
+        data_lanes = 2;
+        command = 0x3B;
+        break;
+    case SpiAnalyzerEnums::Dual122:
+        address_lanes = 2;
+        data_lanes = 2;
+        command = 0xBB;
+        break;
+    case SpiAnalyzerEnums::Quad114:
+        command = 0x6B;
+        break;
+    case SpiAnalyzerEnums::Quad144:
+        address_lanes = 4;
+        break;
+    case SpiAnalyzerEnums::Octal118:
+        data_lanes = 8;
+        command = 0x8B;
+        break;
+    case SpiAnalyzerEnums::Octal188:
+        address_lanes = 8;
+        data_lanes = 8;
+        command = 0xCB;
+        break;
+    case SpiAnalyzerEnums::Octal888:
+    case SpiAnalyzerEnums::Octal888Dtr:
+        command_lanes = 8;
+        address_lanes = 8;
+        data_lanes = 8;
+        command = (mSettings->mLaneMode == SpiAnalyzerEnums::Octal888Dtr) ? 0xEE : 0xCB;
+        break;
+    default:    //Quad444
+        command_lanes = 4;
+        address_lanes = 4;
+        break;
+    }
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+
+    mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
+
+    if (mSettings->mLaneMode == SpiAnalyzerEnums::Octal888Dtr) {
+        //the command goes out with its inverse, and the data bytes in pairs
+        OutputDtrLanes((command << 8) | U8(~command), 1, false);
+        OutputDtrLanes(mValue << 8, mSettings->mAddressBytes / 2, false);
+        OutputLanes(0, mSettings->mDummyCycles, 1);
+
+        U64 data = 0;
+        for (U32 i = 0; i < 4; i++) {
+            data = (data << 8) | (mValue++ & 0xFF);
+        }
+        OutputDtrLanes(data, 2, true);
+    } else {
+        OutputLanes(command, 8 / command_lanes, command_lanes);
+        OutputLanes(mValue << 8, 8 * mSettings->mAddressBytes / address_lanes, address_lanes);
+        OutputLanes(0, mSettings->mDummyCycles, 1);
+
+        for (U32 i = 0; i < 4; i++) {
+            OutputLanes(mValue++, 8 / data_lanes, data_lanes);
+        }
+    }
+
+    for (U32 i = 0; i < SPI_MAX_LANES; i++) {
+        if (mIo[i] != NULL) {
+            mIo[i]->TransitionIfNeeded(BIT_LOW);
+        }
+    }
+
+    mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+}
+
+//one step of a flash session: ID, write enable, program, status poll, the read of the lane mode and a sector erase
+void SpiSimulationDataGenerator::CreateNorTransaction()
+{
+    const U8 read_opcodes[] = { 0x03, 0x3B, 0xBB, 0x6B, 0xEB, 0xEB, 0x8B, 0xCB, 0xCB, 0xEE };  //indexed by SpiAnalyzerEnums::LaneMode
+    const U8 session[] = { 0x9F, 0x06, 0x02, 0x05, 0x05, read_opcodes[mSettings->mLaneMode], 0x20 };
+    const U32 session_length = sizeof(session) / sizeof(session[0]);
+
+    const SpiNorCommand *command = GetSpiNorCommand(session[mNorStep]);
+
+    U32 command_lanes = 1;
+    U32 address_lanes = command->mAddressLanes;
+    U32 data_lanes = command->mDataLanes;
+    if (mSettings->mLaneMode == SpiAnalyzerEnums::Quad444) {
+        command_lanes = 4;
+        address_lanes = 4;
+        data_lanes = 4;
+    } else if ((mSettings->mLaneMode == SpiAnalyzerEnums::Octal888) || (mSettings->mLaneMode == SpiAnalyzerEnums::Octal888Dtr)) {
+        command_lanes = 8;
+        address_lanes = 8;
+        data_lanes = 8;
+    }
+    bool dtr = (mSettings->mLaneMode == SpiAnalyzerEnums::Octal888Dtr);
+
+    U32 address_bytes = command->mAddressBytes;
+    if (address_bytes == SPI_NOR_DEFAULT_ADDRESS) {
+        address_bytes = (mSettings->mAddressBytes == 4) ? 4 : 3;
+    }
+    if ((dtr == true) && (address_bytes != 0)) {
+        address_bytes = 4;
+    }
+
+    //the bytes of the data phase; the first status poll finds the flash busy
+    std::vector<U64> data;
+    if (command->mOpcode == 0x9F) {
+        data.push_back(0xEF);
+        data.push_back(0x40);
+        data.push_back(0x18);
+    } else if (command->mOpcode == 0x05) {
+        data.push_back((session[mNorStep - 1] == 0x05) ? 0x00 : 0x03);
+    } else if ((command->mKind == SpiNorRead) || (command->mKind == SpiNorProgram)) {
+        for (U32 i = 0; i < 4; i++) {
+            data.push_back((mValue + i) & 0xFF);
+        }
+    }
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+
+    mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
+
+    if (dtr == true) {
+        //DTR data goes in byte pairs; a register read repeats its last byte to fill the pair
+        if ((data.size() & 0x1) != 0) {
+            data.push_back(data.back());
+        }
+
+        OutputDtrLanes((U64(command->mOpcode) << 8) | U8(~command->mOpcode), 1, false);
+        if (address_bytes != 0) {
+            OutputDtrLanes(mValue << 8, address_bytes / 2, false);
+        }
+        OutputLanes(0, command->mDummyClocks, 1);
+
+        U64 pairs = 0;
+        for (U32 i = 0; i < data.size(); i++) {
+            pairs = (pairs << 8) | data[i];
+        }
+        OutputDtrLanes(pairs, U32(data.size() / 2), command->mDataFromFlash);
+    } else {
+        OutputLanes(command->mOpcode, 8 / command_lanes, command_lanes);
+        if (address_bytes != 0) {
+            OutputLanes(mValue << 8, 8 * address_bytes / address_lanes, address_lanes);
+        }
+        OutputLanes(0, command->mDummyClocks, 1);
+
+        //data from the flash on a single line is on MISO (IO1)
+        U32 first_line = ((data_lanes == 1) && (command->mDataFromFlash == true)) ? 1 : 0;
+        for (U32 i = 0; i < data.size(); i++) {
+            OutputLanes(data[i], 8 / data_lanes, data_lanes, first_line);
+        }
+    }
+
+    for (U32 i = 0; i < SPI_MAX_LANES; i++) {
+        if (mIo[i] != NULL) {
+            mIo[i]->TransitionIfNeeded(BIT_LOW);
+        }
+    }
+
+    mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+
+    mNorStep++;
+    if (mNorStep == session_length) {
+        mNorStep = 0;
+        mValue += 4;
+    }
+}
+
+//one step of an SD card session: reset, interface condition, initialization, OCR, a block read and a block write
+void SpiSimulationDataGenerator::CreateSdTransaction()
+{
+    const U8 session[] = { 0, 8, 55, 41, 58, 17, 24 };
+    const U32 session_length = sizeof(session) / sizeof(session[0]);
+    const U32 block_length = 512;
+
+    U8 index = session[mSdStep];
+    U32 argument = 0;
+    std::vector<U8> response;
+    if (index == 8) {
+        argument = 0x1AA;
+        response.push_back(0x01);
+        response.push_back(0x00);
+        response.push_back(0x00);
+        response.push_back(0x01);
+        response.push_back(0xAA);
+    } else if (index == 41) {
+        argument = 0x40000000;
+        response.push_back(0x00);
+    } else if (index == 58) {
+        response.push_back(0x00);
+        response.push_back(0xC0);
+        response.push_back(0xFF);
+        response.push_back(0x80);
+        response.push_back(0x00);
+    } else if ((index == 17) || (index == 24)) {
+        argument = U32(mValue);
+        response.push_back(0x00);
+    } else {
+        response.push_back(0x01);   //still idle
+    }
+
+    //the command with its CRC, a byte of Ncr, and the response
+    std::vector<U8> mosi;
+    std::vector<U8> miso;
+    U8 command[6] = { U8(0x40 | index), U8(argument >> 24), U8(argument >> 16), U8(argument >> 8), U8(argument), 0 };
+    command[5] = U8((GetSpiSdCrc7(command, 5) << 1) | 0x01);
+    for (U32 i = 0; i < 6; i++) {
+        mosi.push_back(command[i]);
+        miso.push_back(0xFF);
+    }
+    mosi.push_back(0xFF);
+    miso.push_back(0xFF);
+    for (U32 i = 0; i < response.size(); i++) {
+        mosi.push_back(0xFF);
+        miso.push_back(response[i]);
+    }
+
+    //a data block from the card, or to it followed by the data response and a little busy time
+    if ((index == 17) || (index == 24)) {
+        std::vector<U8> block;
+        block.push_back(0xFE);
+        for (U32 i = 0; i < block_length; i++) {
+            block.push_back(U8(mValue + i));
+        }
+        U16 crc = GetSpiSdCrc16(&block[1], block_length);
+        block.push_back(U8(crc >> 8));
+        block.push_back(U8(crc));
+
+        mosi.push_back(0xFF);
+        miso.push_back(0xFF);
+        for (U32 i = 0; i < block.size(); i++) {
+            mosi.push_back((index == 24) ? block[i] : 0xFF);
+            miso.push_back((index == 17) ? block[i] : 0xFF);
+        }
+
+        if (index == 24) {
+            const U8 write_response[] = { 0xE5, 0x00, 0x00, 0xFF };
+            for (U32 i = 0; i < 4; i++) {
+                mosi.push_back(0xFF);
+                miso.push_back(write_response[i]);
+            }
+        }
+    }
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+
+    mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
+
+    for (U32 i = 0; i < mosi.size(); i++) {
+        if (mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge) {
+            OutputWord_CPHA0(mosi[i], miso[i]);
+        } else {
+            OutputWord_CPHA1(mosi[i], miso[i]);
+        }
+    }
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+
+    mSdStep++;
+    if (mSdStep == session_length) {
+        mSdStep = 0;
+        mValue++;
+    }
+}
+
+//one command of a display session: reset, pixel format and memory access once, then 8x8 pixel blocks filling the screen
+void SpiSimulationDataGenerator::CreateDisplayTransaction()
+{
+    const U8 session[] = { 0x01, 0x3A, 0x36, 0x2A, 0x2B, 0x2C };
+    const U32 session_length = sizeof(session) / sizeof(session[0]);
+    const U32 block_size = 8;
+
+    U32 blocks_per_row = mSettings->mDisplayWidth / block_size;
+    if (blocks_per_row == 0) {
+        blocks_per_row = 1;
+    }
+    U32 block_rows = mSettings->mDisplayHeight / block_size;
+    if (block_rows == 0) {
+        block_rows = 1;
+    }
+    U32 column = U32(mValue % blocks_per_row) * block_size;
+    U32 row = U32((mValue / blocks_per_row) % block_rows) * block_size;
+
+    U8 opcode = session[mDisplayStep];
+    std::vector<U8> parameters;
+    if (opcode == 0x3A) {
+        parameters.push_back(0x55);     //16 bits per pixel
+    } else if (opcode == 0x36) {
+        parameters.push_back(0x00);
+    } else if ((opcode == 0x2A) || (opcode == 0x2B)) {
+        U32 start = (opcode == 0x2A) ? column : row;
+        U32 end = start + block_size - 1;
+        parameters.push_back(U8(start >> 8));
+        parameters.push_back(U8(start));
+        parameters.push_back(U8(end >> 8));
+        parameters.push_back(U8(end));
+    } else if (opcode == 0x2C) {
+        U16 color = U16((((mValue * 5) & 0x1F) << 11) | (((mValue * 3) & 0x3F) << 5) | ((mValue * 7) & 0x1F));
+        for (U32 i = 0; i < block_size * block_size; i++) {
+            parameters.push_back(U8(color >> 8));
+            parameters.push_back(U8(color));
+        }
+    }
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+
+    mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
+
+    //with a D/C line it's low for the command; 3-wire panels get it as the first of 9 bits
+    for (U32 i = 0; i <= parameters.size(); i++) {
+        bool command = (i == 0);
+        U64 word = (command == true) ? opcode : parameters[i - 1];
+        if (mDc != NULL) {
+            mDc->TransitionIfNeeded((command == true) ? BIT_LOW : BIT_HIGH);
+        } else if (command == false) {
+            word |= 0x100;
+        }
+
+        if (mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge) {
+            OutputWord_CPHA0(word, 0);
+        } else {
+            OutputWord_CPHA1(word, 0);
+        }
+    }
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+
+    mDisplayStep++;
+    if (mDisplayStep == session_length) {
+        mDisplayStep = 3;   //the next block
+        mValue++;
+    }
+}
+
+//most significant lane group first, the lowest line carrying the least significant bit of each group
+void SpiSimulationDataGenerator::OutputLanes(U64 data, U32 clocks, U32 lanes, U32 first_line)
+{
+    for (U32 i = 0; i < clocks; i++) {
+        U64 bits = data >> (lanes * (clocks - 1 - i));
+
+        if (mSettings->mDataValidEdge == AnalyzerEnums::TrailingEdge) {
+            mClock->Transition();  //data invalid
+        }
+
+        for (U32 j = 0; j < lanes; j++) {
+            if (mIo[first_line + j] != NULL) {
+                mIo[first_line + j]->TransitionIfNeeded(((bits >> j) & 0x1) ? BIT_HIGH : BIT_LOW);
+            }
+        }
+
+        mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.5));
+        mClock->Transition();  //data valid
+        mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.5));
+
+        if (mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge) {
+            mClock->Transition();  //data invalid
+        }
+    }
+}
+
+//a byte on all eight lines at each clock edge, most significant first. Data the flash drives changes just after
+//the edge, together with DQS when it's recorded, as a flash does; everything else is centered between the edges.
+void SpiSimulationDataGenerator::OutputDtrLanes(U64 data, U32 clocks, bool from_flash)
+{
+    if (from_flash == true) {
+        mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.25));
+    }
+
+    for (U32 i = 0; i < 2 * clocks; i++) {
+        U64 bits = data >> (8 * (2 * clocks - 1 - i));
+
+        if (from_flash == true) {
+            mClock->Transition();
+            mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.05));
+        }
+
+        for (U32 j = 0; j < 8; j++) {
+            if (mIo[j] != NULL) {
+                mIo[j]->TransitionIfNeeded(((bits >> j) & 0x1) ? BIT_HIGH : BIT_LOW);
+            }
+        }
+
+        if (from_flash == true) {
+            if (mDqs != NULL) {
+                mDqs->Transition();
+            }
+            mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.45));
+        } else {
+            mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.25));
+            mClock->Transition();
+            mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.25));
+        }
+    }
+}
+
+//independent data lines: four words on every line, like the converters of a multi-channel ADC. Line n counts from 16 * n,
+//so every line shows different words.
+void SpiSimulationDataGenerator::CreateIndependentTransaction()
+{
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+
+    mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
+
+    bool cpha0 = (mSettings->mDataValidEdge == AnalyzerEnums::LeadingEdge);
+    U32 bits = mSettings->mBitsPerTransfer;
+    for (U32 word = 0; word < 4; word++) {
+        for (U32 i = 0; i < bits; i++) {
+            U32 bit = (mSettings->mShiftOrder == AnalyzerEnums::MsbFirst) ? (bits - 1 - i) : i;
+
+            if (cpha0 == false) {
+                mClock->Transition();  //data invalid
+            }
+            for (U32 line = 0; line < SPI_MAX_LANES; line++) {
+                if (mIo[line] != NULL) {
+                    U64 value = mValue + 16 * line;
+                    mIo[line]->TransitionIfNeeded((((value >> bit) & 1) != 0) ? BIT_HIGH : BIT_LOW);
+                }
+            }
+
+            mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.5));
+            mClock->Transition();  //data valid
+
+            mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(.5));
+            if (cpha0 == true) {
+                mClock->Transition();  //data invalid
+            }
+        }
+        mValue++;
+
+        for (U32 line = 0; line < SPI_MAX_LANES; line++) {
+            if (mIo[line] != NULL) {
+                mIo[line]->TransitionIfNeeded(BIT_LOW);
+            }
+        }
+        mSpiSimulationChannels.AdvanceAll(mClockGenerator.AdvanceByHalfPeriod(2.0));
+    }
+
+    if (mEnable != NULL) {
+        mEnable->Transition();
+    }
+}
@@ -2,8 +2,7 @@
 #define SPI_SIMULATION_DATA_GENERATOR
 
 #include <AnalyzerHelpers.h>
-
-class SpiAnalyzerSettings;
+#include "SpiAnalyzerSettings.h"
 
 class SpiSimulationDataGenerator
 {
@@ -18,6 +17,9 @@ protected:
     SpiAnalyzerSettings *mSettings;
     U32 mSimulationSampleRateHz;
     U64 mValue;
+    U32 mNorStep;
+    U32 mSdStep;
+    U32 mDisplayStep;
 
 protected: //SPI specific
     ClockGenerator mClockGenerator;
@@ -25,12 +27,24 @@ protected: //SPI specific
     void CreateSpiTransaction();
     void OutputWord_CPHA0(U64 mosi_data, U64 miso_data);
     void OutputWord_CPHA1(U64 mosi_data, U64 miso_data);
+    void CreateLaneTransaction();
+    void OutputLanes(U64 data, U32 clocks, U32 lanes, U32 first_line = 0);
+    void OutputDtrLanes(U64 data, U32 clocks, bool from_flash);
+    void CreateNorTransaction();
+    void CreateSdTransaction();
+    void CreateDisplayTransaction();
+    void CreateIndependentTransaction();
 
 
     SimulationChannelDescriptorGroup mSpiSimulationChannels;
     SimulationChannelDescriptor *mMiso;
     SimulationChannelDescriptor *mMosi;
     SimulationChannelDescriptor *mClock;
-    SimulationChannelDescriptor *mEnable;
+    SimulationChannelDescriptor *mEnable;   //the enable line of the slave the next transaction is for
+    SimulationChannelDescriptor *mEnables[SPI_MAX_SLAVES];
+    U32 mSlave;
+    SimulationChannelDescriptor *mIo[SPI_MAX_LANES];    //dual, quad and octal modes: IO0 is MOSI, IO1 is MISO
+    SimulationChannelDescriptor *mDqs;
+    SimulationChannelDescriptor *mDc;
 };
 #endif //SPI_SIMULATION_DATA_GENERATOR